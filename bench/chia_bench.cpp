@@ -1,5 +1,6 @@
 #include <chrono>
 #include <bls12_381.hpp>
+#include "../src/sha256.hpp"
 #include <iostream>
 #include <random>
 
@@ -69,6 +70,66 @@ void benchSigs() {
     endStopwatch(testName, start, numIters);
 }
 
+void benchSha256() {
+    const int numIters = 100000;
+    cout << endl << "SHA-256 (" << (sha256::hardwareAccelerated() ? "SHA-NI" : "generic") << ")" << endl;
+    for (size_t len : {32, 64, 128, 256, 512, 1024}) {
+        vector<uint8_t> data(len, 0x61);
+        array<uint8_t, 32> h;
+        auto start = startStopwatch();
+        for (int i = 0; i < numIters; i++) {
+            data[0] = h[0];
+            sha256 s;
+            s.update(data.data(), data.size());
+            h = s.digest();
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        cout << len << " bytes: " << ns / static_cast<double>(numIters) << " ns/hash, "
+             << (len * 1000.0 * numIters) / ns << " MB/s" << endl;
+    }
+}
+
+void benchHashToG2Stages() {
+    const int numIters = 1000;
+    const string dst = "BLS_SIG_BLS12381G2_XMD:SHA-256_SSWU_RO_NUL_";
+    vector<uint8_t> message = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    auto start = startStopwatch();
+    array<fp2, 2> u;
+    for (int i = 0; i < numIters; i++) {
+        message[0] = i;
+        u = g2::hashToField(message, dst);
+    }
+    endStopwatch("Hash to G2: hash_to_field", start, numIters);
+
+    start = startStopwatch();
+    fp2 xNum, xDen, y;
+    for (int i = 0; i < numIters; i++) {
+        tie(xNum, xDen, y) = g2::swuMapG2(u[i & 1]);
+    }
+    endStopwatch("Hash to G2: map_to_curve (SSWU)", start, numIters);
+
+    g2 q;
+    start = startStopwatch();
+    for (int i = 0; i < numIters; i++) {
+        q = g2::isogenyMapG2(xNum, xDen, y);
+    }
+    endStopwatch("Hash to G2: iso_map", start, numIters);
+
+    start = startStopwatch();
+    for (int i = 0; i < numIters; i++) {
+        q = q.clearCofactor();
+    }
+    endStopwatch("Hash to G2: clear_cofactor", start, numIters);
+
+    start = startStopwatch();
+    for (int i = 0; i < numIters; i++) {
+        message[0] = i;
+        q = g2::fromMessage(message, dst);
+    }
+    endStopwatch("Hash to G2: total", start, numIters);
+}
+
 void benchVerification() {
     string testName = "Verification";
     const int numIters = 10000;
@@ -141,6 +202,29 @@ void benchBatchVerification() {
     endStopwatch("Batch verification", start, numIters);
 }
 
+void benchIndependentBatchVerification() {
+    const int numIters = 1000;
+
+    vector<g1> pks;
+    vector<vector<uint8_t>> ms;
+    vector<g2> sigs;
+
+    for (int i = 0; i < numIters; i++) {
+        uint8_t message[4];
+        IntToFourBytes(message, i);
+        vector<uint8_t> messageBytes(message, message + 4);
+        array<uint64_t, 4> sk = secret_key(getRandomSeed());
+        pks.push_back(public_key(sk));
+        sigs.push_back(sign(sk, messageBytes));
+        ms.push_back(messageBytes);
+    }
+
+    auto start = startStopwatch();
+    bool ok = batch_verify(pks, ms, sigs);
+    if(!ok) throw invalid_argument("benchIndependentBatchVerification: !ok");
+    endStopwatch("Randomized batch verification", start, numIters);
+}
+
 void benchFastAggregateVerification() {
     const int numIters = 5000;
 
@@ -177,8 +261,11 @@ void benchFastAggregateVerification() {
 
 int main(int argc, char* argv[])
 {
+    benchSha256();
+    benchHashToG2Stages();
     benchSigs();
     benchVerification();
     benchBatchVerification();
+    benchIndependentBatchVerification();
     benchFastAggregateVerification();
 }
\ No newline at end of file
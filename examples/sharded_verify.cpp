@@ -0,0 +1,120 @@
+// Shards an aggregate verification over several local worker processes. Every worker
+// computes the partial Miller loop product of its share of (public key, message) pairs
+// and sends it back in the stable 576 byte encoding of fp12. The parent combines all
+// partials with the aggregated signature and runs a single final exponentiation.
+//
+// usage: sharded_verify [numSigs] [numWorkers]
+#include <bls12_381.hpp>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace bls12_381;
+
+int main(int argc, char* argv[])
+{
+    const size_t numSigs = argc > 1 ? stoul(argv[1]) : 256;
+    const size_t numWorkers = argc > 2 ? stoul(argv[2]) : 4;
+
+    vector<g1> pks;
+    vector<vector<uint8_t>> msgs;
+    vector<g2> sigs;
+    for(size_t i = 0; i < numSigs; i++)
+    {
+        vector<uint8_t> seed(32, 0);
+        memcpy(seed.data(), &i, sizeof(i));
+        array<uint64_t, 4> sk = secret_key(seed);
+        vector<uint8_t> msg(seed.begin(), seed.begin() + 8);
+        pks.push_back(public_key(sk));
+        msgs.push_back(msg);
+        sigs.push_back(sign(sk, msg));
+    }
+    g2 aggSig = aggregate_signatures(sigs);
+
+    auto start = chrono::steady_clock::now();
+
+    // start workers
+    vector<pid_t> pids;
+    vector<int> fds;
+    for(size_t w = 0; w < numWorkers; w++)
+    {
+        int fd[2];
+        if(pipe(fd) != 0)
+        {
+            cerr << "pipe failed" << endl;
+            return 1;
+        }
+        pid_t pid = fork();
+        if(pid < 0)
+        {
+            cerr << "fork failed" << endl;
+            return 1;
+        }
+        if(pid == 0)
+        {
+            close(fd[0]);
+            vector<g1> shardPks;
+            vector<vector<uint8_t>> shardMsgs;
+            for(size_t i = w; i < numSigs; i += numWorkers)
+            {
+                shardPks.push_back(pks[i]);
+                shardMsgs.push_back(msgs[i]);
+            }
+            fp12 partial;
+            if(!aggregate_verify_partial(partial, shardPks, shardMsgs))
+            {
+                _exit(1);
+            }
+            array<uint8_t, 576> bytes = partial.toBytesBE();
+            bool sent = write(fd[1], bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+            close(fd[1]);
+            _exit(sent ? 0 : 1);
+        }
+        close(fd[1]);
+        pids.push_back(pid);
+        fds.push_back(fd[0]);
+    }
+
+    // collect partial products
+    vector<fp12> partials;
+    bool ok = true;
+    for(size_t w = 0; w < numWorkers; w++)
+    {
+        array<uint8_t, 576> bytes;
+        size_t n = 0;
+        while(n < bytes.size())
+        {
+            ssize_t r = read(fds[w], bytes.data() + n, bytes.size() - n);
+            if(r <= 0)
+            {
+                break;
+            }
+            n += r;
+        }
+        close(fds[w]);
+        int status;
+        waitpid(pids[w], &status, 0);
+        if(n != bytes.size() || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            ok = false;
+            continue;
+        }
+        partials.push_back(fp12::fromBytesBE(bytes));
+    }
+    ok = ok && aggregate_verify_combine(partials, aggSig);
+
+    auto end = chrono::steady_clock::now();
+    cout << numSigs << " signatures on " << numWorkers << " workers: " << (ok ? "valid" : "INVALID") << " ("
+         << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms)" << endl;
+
+    start = chrono::steady_clock::now();
+    bool okSingle = aggregate_verify(pks, msgs, aggSig);
+    end = chrono::steady_clock::now();
+    cout << numSigs << " signatures in a single process: " << (okSingle ? "valid" : "INVALID") << " ("
+         << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms)" << endl;
+
+    return ok && okSingle ? 0 : 1;
+}
@@ -3,6 +3,7 @@
 #include "arithmetic.hpp"
 #include "scalar.hpp"
 #include "fp.hpp"
+#include "cache.hpp"
 #include "g.hpp"
 #include "pairing.hpp"
 #include "signatures.hpp"
@@ -0,0 +1,221 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace bls12_381
+{
+
+class g1;
+class g2;
+
+// Hashes fixed size byte arrays (e.g. compressed points or digests) over all of their bytes
+struct bytes_hash
+{
+    template<size_t N>
+    size_t operator()(const array<uint8_t, N>& a) const
+    {
+        return hash<string_view>()(string_view(reinterpret_cast<const char*>(a.data()), N));
+    }
+};
+
+// Thread-safe, bounded key-value cache. The keys are distributed over independently locked shards, each
+// of which evicts its least recently used entry once it is full. Hits and misses are counted.
+template<typename K, typename V, typename H = hash<K>>
+class concurrent_cache
+{
+
+public:
+    explicit concurrent_cache(const size_t capacity, const size_t numShards = 16);
+
+    optional<V> find(const K& key);
+    void insert(const K& key, const V& value);
+    // Returns the cached value or caches and returns compute(). Nothing is cached if compute() throws.
+    template<typename F> V findOrInsert(const K& key, F compute);
+    void erase(const K& key);
+    void clear();
+    // Changes the capacity, evicting the least recently used entries that no longer fit
+    void setCapacity(const size_t capacity);
+
+    size_t size() const;
+    size_t capacity() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct shard
+    {
+        mutable mutex m;
+        list<pair<K, V>> lru;    // most recently used first
+        unordered_map<K, typename list<pair<K, V>>::iterator, H> index;
+    };
+    shard& shardOf(const K& key);
+
+    vector<unique_ptr<shard>> m_shards;
+    atomic<size_t> m_shardCapacity;
+    atomic<uint64_t> m_hits;
+    atomic<uint64_t> m_misses;
+};
+
+template<typename K, typename V, typename H>
+concurrent_cache<K, V, H>::concurrent_cache(const size_t capacity, const size_t numShards) :
+    m_shards(numShards == 0 ? 1 : numShards),
+    m_shardCapacity((capacity + m_shards.size() - 1) / m_shards.size()),
+    m_hits(0),
+    m_misses(0)
+{
+    for(unique_ptr<shard>& s : m_shards)
+    {
+        s = make_unique<shard>();
+    }
+}
+
+template<typename K, typename V, typename H>
+typename concurrent_cache<K, V, H>::shard& concurrent_cache<K, V, H>::shardOf(const K& key)
+{
+    // the (mixed) upper bits pick the shard, the lower ones the bucket within it
+    const uint64_t h = H()(key) * 0x9e3779b97f4a7c15;
+    return *m_shards[(h >> 40) % m_shards.size()];
+}
+
+template<typename K, typename V, typename H>
+optional<V> concurrent_cache<K, V, H>::find(const K& key)
+{
+    shard& s = shardOf(key);
+    lock_guard<mutex> lock(s.m);
+    auto it = s.index.find(key);
+    if(it == s.index.end())
+    {
+        m_misses.fetch_add(1, memory_order_relaxed);
+        return nullopt;
+    }
+    m_hits.fetch_add(1, memory_order_relaxed);
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    return it->second->second;
+}
+
+template<typename K, typename V, typename H>
+void concurrent_cache<K, V, H>::insert(const K& key, const V& value)
+{
+    const size_t shardCapacity = m_shardCapacity;
+    if(shardCapacity == 0)
+    {
+        return;
+    }
+    shard& s = shardOf(key);
+    lock_guard<mutex> lock(s.m);
+    auto it = s.index.find(key);
+    if(it != s.index.end())
+    {
+        it->second->second = value;
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return;
+    }
+    while(s.lru.size() >= shardCapacity)
+    {
+        s.index.erase(s.lru.back().first);
+        s.lru.pop_back();
+    }
+    s.lru.emplace_front(key, value);
+    s.index.emplace(key, s.lru.begin());
+}
+
+template<typename K, typename V, typename H>
+template<typename F>
+V concurrent_cache<K, V, H>::findOrInsert(const K& key, F compute)
+{
+    optional<V> cached = find(key);
+    if(cached)
+    {
+        return *cached;
+    }
+    // computed without holding the lock; concurrent misses on the same key may compute it twice
+    V value = compute();
+    insert(key, value);
+    return value;
+}
+
+template<typename K, typename V, typename H>
+void concurrent_cache<K, V, H>::erase(const K& key)
+{
+    shard& s = shardOf(key);
+    lock_guard<mutex> lock(s.m);
+    auto it = s.index.find(key);
+    if(it != s.index.end())
+    {
+        s.lru.erase(it->second);
+        s.index.erase(it);
+    }
+}
+
+template<typename K, typename V, typename H>
+void concurrent_cache<K, V, H>::clear()
+{
+    for(unique_ptr<shard>& s : m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        s->index.clear();
+        s->lru.clear();
+    }
+    m_hits = 0;
+    m_misses = 0;
+}
+
+template<typename K, typename V, typename H>
+void concurrent_cache<K, V, H>::setCapacity(const size_t capacity)
+{
+    m_shardCapacity = (capacity + m_shards.size() - 1) / m_shards.size();
+    for(unique_ptr<shard>& s : m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        while(s->lru.size() > m_shardCapacity)
+        {
+            s->index.erase(s->lru.back().first);
+            s->lru.pop_back();
+        }
+    }
+}
+
+template<typename K, typename V, typename H>
+size_t concurrent_cache<K, V, H>::size() const
+{
+    size_t n = 0;
+    for(const unique_ptr<shard>& s : m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        n += s->lru.size();
+    }
+    return n;
+}
+
+template<typename K, typename V, typename H>
+size_t concurrent_cache<K, V, H>::capacity() const
+{
+    return m_shardCapacity * m_shards.size();
+}
+
+template<typename K, typename V, typename H>
+uint64_t concurrent_cache<K, V, H>::hits() const
+{
+    return m_hits.load(memory_order_relaxed);
+}
+
+template<typename K, typename V, typename H>
+uint64_t concurrent_cache<K, V, H>::misses() const
+{
+    return m_misses.load(memory_order_relaxed);
+}
+
+// Caches of validated (on curve, in the correct subgroup) affine points keyed by their compressed encoding
+typedef concurrent_cache<array<uint8_t, 48>, g1, bytes_hash> g1_cache;
+typedef concurrent_cache<array<uint8_t, 96>, g2, bytes_hash> g2_cache;
+
+} // namespace bls12_381
@@ -44,6 +44,8 @@ public:
     fp fromMont() const;
     template<size_t N> fp exp(const array<uint64_t, N>& s) const;
     fp inverse() const;
+    // Inverse as x^(p-2): a fixed sequence of multiplications, for secret dependent values (inverse() branches)
+    fp inverseConstTime() const;
     bool sqrt(fp& c) const;
     bool isQuadraticNonResidue() const;
     bool isLexicographicallyLargest() const;
@@ -53,12 +55,14 @@ public:
     static const uint64_t INP;                          // INP = -(p^{-1} mod 2^64) mod 2^64
     static const fp R1;                                 // base field identity: R1 = 2^384 mod p
     static const fp R2;                                 // fp identity squared: R2 = 2^(384*2) mod p
+    static const fp R3;                                 // R3 = 2^(384*3) mod p
     static const fp B;                                  // B coefficient from cure equation: y^2 = x^3 + B
     static const fp twoInv;
     static const array<uint64_t, 4> Q;                  // scalar field modulus: q = 52435875175126190479447740508185965837690552500527637822603658699938581184513 or 0x73eda753299d7d483339d80809a1d80553bda402fffe5bfeffffffff00000001
     static const array<uint64_t, 6> pPlus1Over4;
     static const array<uint64_t, 6> pMinus1Over2;
     static const array<uint64_t, 6> pMinus3Over4;
+    static const array<uint64_t, 6> pMinus2;
 };
 
 // element representation of 'fp2' field which is quadratic extension of base field 'fp'
@@ -101,6 +105,7 @@ public:
     fp2 mulByNonResidue() const;
     fp2 mulByB() const;
     fp2 inverse() const;
+    fp2 inverseConstTime() const;
     fp2 mulByFq(const fp& e) const;
     template<size_t N> fp2 exp(const array<uint64_t, N>& s) const;
     fp2 frobeniusMap(const uint64_t& power) const;
@@ -150,6 +155,7 @@ public:
     void mulBy01Assign(const fp2& e0, const fp2& e1);
     fp6 mulBy01(const fp2& e0, const fp2& e1) const;
     fp6 mulBy1(const fp2& e1) const;
+    fp6 mulBy12(const fp2& e1, const fp2& e2) const;
     fp6 mulByNonResidue() const;
     fp6 mulByBaseField(const fp2& e) const;
     template<size_t N> fp6 exp(const array<uint64_t, N>& s) const;
@@ -197,6 +203,10 @@ public:
     static tuple<fp2, fp2> fp4Square(const fp2& e0, const fp2& e1);
     fp12 inverse() const;
     void mulBy014Assign(const fp2& e0, const fp2& e1, const fp2& e4);
+    void mulBy014Assign(const fp2& e0, const fp2& e1, const fp& e4);
+    static fp12 mul014By014(const fp2& a0, const fp2& a1, const fp2& a4, const fp2& b0, const fp2& b1, const fp2& b4);
+    static fp12 mul014By014(const fp2& a0, const fp2& a1, const fp& a4, const fp2& b0, const fp2& b1, const fp& b4);
+    void mulBy01245Assign(const fp12& e);
     template<size_t N> fp12 exp(const array<uint64_t, N>& s) const;
     template<size_t N> fp12 cyclotomicExp(const array<uint64_t, N>& s) const;
     fp12 frobeniusMap(const uint64_t& power) const;
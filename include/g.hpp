@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include <vector>
+#include "cache.hpp"
 
 namespace bls12_381
 {
@@ -9,6 +10,11 @@ class fp;
 class fp2;
 class fp6;
 class fp12;
+class hash_to_curve_context;
+class g1_affine;
+class g2_affine;
+class g1_projective;
+class g2_projective;
 
 // g1 is type for point in G1.
 // g1 is both used for Affine and Jacobian point representation.
@@ -24,9 +30,13 @@ public:
     g1();
     g1(const array<fp, 3>& e3);
     g1(const g1& e);
+    explicit g1(const g1_affine& e);
+    explicit g1(const g1_projective& e);
     static g1 fromJacobianBytesBE(const span<const uint8_t, 144> in, const bool check = false);
     static g1 fromAffineBytesBE(const span<const uint8_t, 96> in, const bool check = false);
     static g1 fromCompressedBytesBE(const span<const uint8_t, 48> in);
+    // Also checks the subgroup and caches the validated point under its encoding
+    static g1 fromCompressedBytesBE(const span<const uint8_t, 48> in, g1_cache& cache);
     void toJacobianBytesBE(const span<uint8_t, 144> out) const;
     void toAffineBytesBE(const span<uint8_t, 96> out) const;
     void toCompressedBytesBE(const span<uint8_t, 48> out) const;
@@ -41,21 +51,83 @@ public:
     bool isOnCurve() const;
     bool isAffine() const;
     g1 affine() const;
+    static void batchAffine(span<g1> points);
     g1 add(const g1& e) const;
+    // Addition of an affine point (z == 1); falls back to add otherwise
+    g1 addMixed(const g1& e) const;
+    g1 addMixed(const g1_affine& e) const;
     g1 dbl() const;
+    // Doubles n times (returns 2^n * this)
+    g1 dblN(const uint64_t n) const;
     g1 neg() const;
     g1 sub(const g1& e) const;
     template<size_t N> g1 mulScalar(const array<uint64_t, N>& s) const;
     g1 clearCofactor() const;
-    static g1 multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers);
+    static g1 multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits = 255);
+    static g1 multiExp(span<const g1_affine> points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits = 255);
     static g1 mapToCurve(const array<uint8_t, 48>& in);
-    static tuple<fp, fp> swuMapG1(const fp& e);
-    static void isogenyMapG1(fp& x, fp& y);
+    static tuple<fp, fp, fp> swuMapG1(const fp& e);
+    static g1 isogenyMapG1(const fp& xNum, const fp& xDen, const fp& y);
 
     static const g1 BASE;
     static const array<uint64_t, 1> cofactorEFF;
 };
 
+// g1_affine is an affine point in G1 with an explicit flag for the point at infinity. At two thirds of
+// the size of g1 it is meant for points that are stored (public keys, bases, tables) rather than computed with.
+class g1_affine
+{
+
+public:
+    fp x;
+    fp y;
+    bool infinity;
+
+    g1_affine();
+    g1_affine(const fp& x, const fp& y);
+    explicit g1_affine(const g1& e);
+    // Converts all points using a single field inversion
+    static vector<g1_affine> fromJacobian(span<const g1> points);
+    static g1_affine fromCompressedBytesBE(const span<const uint8_t, 48> in);
+    array<uint8_t, 48> toCompressedBytesBE() const;
+    static g1_affine zero();
+    bool isZero() const;
+    bool equal(const g1_affine& e) const;
+    bool inCorrectSubgroup() const;
+    bool isOnCurve() const;
+    g1_affine neg() const;
+};
+
+// g1_projective is a point in G1 in homogeneous projective coordinates (X : Y : Z) representing (X/Z, Y/Z), with
+// the point at infinity being (0 : 1 : 0). Its arithmetic uses the complete formulas for a = 0 curves by Renes,
+// Costello and Batina (https://eprint.iacr.org/2015/1060): there are no exceptional cases and no branches, so the
+// sequence of field operations never depends on the points. Meant for operations on secret scalars.
+class g1_projective
+{
+
+public:
+    fp x;
+    fp y;
+    fp z;
+
+    g1_projective();
+    explicit g1_projective(const g1& e);
+    explicit g1_projective(const g1_affine& e);
+    // Affine g1 (z = 1) computed with a constant time inversion, so that a secret dependent z does not leak
+    g1 affine() const;
+    static g1_projective zero();
+    bool isZero() const;
+    bool equal(const g1_projective& e) const;
+    g1_projective add(const g1_projective& e) const;
+    g1_projective addMixed(const g1_affine& e) const;
+    g1_projective dbl() const;
+    g1_projective neg() const;
+    // Returns a if c is true and b otherwise, without branching on c
+    static g1_projective select(const bool c, const g1_projective& a, const g1_projective& b);
+    // Fixed window multiplication by all 256 bits of s, independent of its value
+    g1_projective mulScalar(const array<uint64_t, 4>& s) const;
+};
+
 // g2 is type for point in G2.
 // g2 is both used for Affine and Jacobian point representation.
 // If z is equal to one the point is considered as in affine form.
@@ -70,9 +142,13 @@ public:
     g2();
     g2(const array<fp2, 3>& e3);
     g2(const g2& e);
+    explicit g2(const g2_affine& e);
+    explicit g2(const g2_projective& e);
     static g2 fromJacobianBytesBE(const span<const uint8_t, 288> in, const bool check = false);
     static g2 fromAffineBytesBE(const span<const uint8_t, 192> in, const bool check = false);
     static g2 fromCompressedBytesBE(const span<const uint8_t, 96> in);
+    // Also checks the subgroup and caches the validated point under its encoding
+    static g2 fromCompressedBytesBE(const span<const uint8_t, 96> in, g2_cache& cache);
     void toJacobianBytesBE(const span<uint8_t, 288> out) const;
     void toAffineBytesBE(const span<uint8_t, 192> out) const;
     void toCompressedBytesBE(const span<uint8_t, 96> out) const;
@@ -87,22 +163,88 @@ public:
     bool isOnCurve() const;
     bool isAffine() const;
     g2 affine() const;
+    static void batchAffine(span<g2> points);
     g2 add(const g2& e) const;
+    // Addition of an affine point (z == 1); falls back to add otherwise
+    g2 addMixed(const g2& e) const;
+    g2 addMixed(const g2_affine& e) const;
     g2 dbl() const;
+    // Doubles n times (returns 2^n * this)
+    g2 dblN(const uint64_t n) const;
     g2 neg() const;
     g2 sub(const g2& e) const;
     template<size_t N> g2 mulScalar(const array<uint64_t, N>& s) const;
     g2 clearCofactor() const;
     g2 frobeniusMap(int64_t power) const;
-    static g2 multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers);
+    static g2 multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits = 255);
+    static g2 multiExp(span<const g2_affine> points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits = 255);
     static g2 mapToCurve(const fp2& e);
+    static array<fp2, 2> hashToField(const vector<uint8_t>& msg, const string& dst);
+    static array<fp2, 2> hashToField(const vector<uint8_t>& msg, const hash_to_curve_context& ctx);
     static g2 fromMessage(const vector<uint8_t>& msg, const string& dst);
-    static tuple<fp2, fp2> swuMapG2(const fp2& e);
-    //static void isogenyMapG2(fp2& x, fp2& y);
-    g2 isogenyMap() const;
+    static g2 fromMessage(const vector<uint8_t>& msg, const hash_to_curve_context& ctx);
+    static vector<g2> fromMessages(span<const vector<uint8_t>> msgs, const string& dst);
+    static vector<g2> fromMessages(span<const vector<uint8_t>> msgs, const hash_to_curve_context& ctx);
+    static tuple<fp2, fp2, fp2> swuMapG2(const fp2& e);
+    static g2 isogenyMapG2(const fp2& xNum, const fp2& xDen, const fp2& y);
 
     static const g2 BASE;
     static const array<uint64_t, 1> cofactorEFF;
 };
 
+// g2_affine is an affine point in G2 with an explicit flag for the point at infinity. At two thirds of
+// the size of g2 it is meant for points that are stored (public keys, bases, tables) rather than computed with.
+class g2_affine
+{
+
+public:
+    fp2 x;
+    fp2 y;
+    bool infinity;
+
+    g2_affine();
+    g2_affine(const fp2& x, const fp2& y);
+    explicit g2_affine(const g2& e);
+    // Converts all points using a single field inversion
+    static vector<g2_affine> fromJacobian(span<const g2> points);
+    static g2_affine fromCompressedBytesBE(const span<const uint8_t, 96> in);
+    array<uint8_t, 96> toCompressedBytesBE() const;
+    static g2_affine zero();
+    bool isZero() const;
+    bool equal(const g2_affine& e) const;
+    bool inCorrectSubgroup() const;
+    bool isOnCurve() const;
+    g2_affine neg() const;
+};
+
+// g2_projective is a point in G2 in homogeneous projective coordinates (X : Y : Z) representing (X/Z, Y/Z), with
+// the point at infinity being (0 : 1 : 0). Its arithmetic uses the complete formulas for a = 0 curves by Renes,
+// Costello and Batina (https://eprint.iacr.org/2015/1060): there are no exceptional cases and no branches, so the
+// sequence of field operations never depends on the points. Meant for operations on secret scalars.
+class g2_projective
+{
+
+public:
+    fp2 x;
+    fp2 y;
+    fp2 z;
+
+    g2_projective();
+    explicit g2_projective(const g2& e);
+    explicit g2_projective(const g2_affine& e);
+    // Affine g2 (z = 1) computed with a constant time inversion, so that a secret dependent z does not leak
+    g2 affine() const;
+    static g2_projective zero();
+    bool isZero() const;
+    bool equal(const g2_projective& e) const;
+    g2_projective add(const g2_projective& e) const;
+    g2_projective addMixed(const g2_affine& e) const;
+    g2_projective dbl() const;
+    g2_projective neg() const;
+    // Returns a if c is true and b otherwise, without branching on c
+    static g2_projective select(const bool c, const g2_projective& a, const g2_projective& b);
+    // Fixed window multiplication by all 256 bits of s, independent of its value
+    g2_projective mulScalar(const array<uint64_t, 4>& s) const;
+};
+
 } // namespace bls12_381
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
 #include <vector>
+#include <span>
+#include <tuple>
 
 namespace bls12_381
 {
@@ -11,6 +13,8 @@ class fp6;
 class fp12;
 class g1;
 class g2;
+class g1_affine;
+class g2_affine;
 
 class pairing
 {
@@ -19,9 +23,27 @@ public:
     static void doublingStep(array<fp2, 3>& coeff, g2& r);
     static void additionStep(array<fp2, 3>& coeff, g2& r, g2& tp);
     static void preCompute(array<array<fp2, 3>, 68>& ellCoeffs, g2& twistPoint);
-    static fp12 millerLoop(vector<tuple<g1, g2>>& pairs);
+    static void preCompute(array<array<fp2, 2>, 68>& ellCoeffs, g2& twistPoint);
+    static fp12 millerLoop(span<const tuple<g1, g2>> pairs);
+    static fp12 millerLoop(span<const tuple<g1_affine, g2_affine>> pairs);
+    static fp12 millerLoop(span<const g1> p, span<const array<array<fp2, 3>, 68>* const> ellCoeffs);
+    static fp12 millerLoop(span<const g1> p, span<const array<array<fp2, 2>, 68>* const> ellCoeffs);
+    static fp12 millerLoop(
+        span<const g1> p,
+        span<const array<array<fp2, 3>, 68>* const> ellCoeffs,
+        span<const g1> pCompact,
+        span<const array<array<fp2, 2>, 68>* const> compactCoeffs
+    );
     static void finalExp(fp12& f);
+    static bool finalExpIsOne(const fp12& f);
     static fp12 calculate(vector<tuple<g1, g2>>& pairs);
+    static bool check(span<const tuple<g1, g2>> pairs);
+    static bool check(span<const tuple<g1_affine, g2_affine>> pairs);
+    static bool check(span<const tuple<g1, array<array<fp2, 3>, 68>>> pairs);
+    static bool check(span<const tuple<g1, array<array<fp2, 2>, 68>>> pairs);
+    static fp12 combine(span<const fp12> partials);
+    static fp12 calculateCombined(span<const fp12> partials);
+    static bool checkCombined(span<const fp12> partials);
     static void addPair(vector<tuple<g1, g2>>& pairs, const g1& e1, const g2& e2);
 };
 
@@ -196,19 +196,58 @@ void rsh(array<uint64_t, N>& arr, uint64_t bits)
     }
 }
 
+// montgomery multiplication modulo the group order q (fp::Q): returns a * b * 2^-256 mod q, b must be less than q
+array<uint64_t, 4> montMulModOrder(const array<uint64_t, 4>& a, const array<uint64_t, 4>& b);
+
+// subtracts q from a until it is less than q (at most twice for a 256 bit input)
+void reduceModOrder(array<uint64_t, 4>& a);
+
+// calculates (a + b) mod q for a, b less than q
+array<uint64_t, 4> addModOrder(const array<uint64_t, 4>& a, const array<uint64_t, 4>& b);
+
+extern const array<uint64_t, 4> ORDER_R2;           // 2^(256*2) mod q
+
+// Reduces a number of up to 512 bits modulo the group order q (fp::Q). The input is split into
+// k = hi * 2^256 + lo: lo is reduced by conditional subtraction and hi * 2^256 = mont(hi, 2^512 mod q)
+// needs a single montgomery multiplication.
+template<size_t N>
+array<uint64_t, 4> modOrder(const array<uint64_t, N>& k)
+{
+    static_assert(N <= 8, "modOrder supports at most 512 bit inputs");
+    array<uint64_t, 4> lo = {0, 0, 0, 0}, hi = {0, 0, 0, 0};
+    for(size_t i = 0; i < 4; i++)
+    {
+        lo[i] = i < N ? k[i] : 0;
+        hi[i] = i + 4 < N ? k[i + 4] : 0;
+    }
+    reduceModOrder(lo);
+    if(N > 4)
+    {
+        lo = addModOrder(lo, montMulModOrder(hi, ORDER_R2));
+    }
+    return lo;
+}
+
 } // namespace scalar
 
 void bn_divn_low(uint64_t *c, uint64_t *d, uint64_t *a, int sa, uint64_t *b, int sb);
 
+// Reduces a number of up to 768 bits modulo p and returns it in montgomery form. The input is split into
+// k = hi * 2^384 + lo, so that k * R = mont(lo, R2) + mont(hi, R3) needs just two montgomery multiplications.
 template<size_t N>
 fp fp::modPrime(array<uint64_t, N> k)
 {
-    array<uint64_t, N> quotient = {0};
-    array<uint64_t, N> remainder = {0};
-    array<uint64_t, 6> modulus = fp::MODULUS.d;
-    bn_divn_low(quotient.data(), remainder.data(), k.data(), N, modulus.data(), 6);
-    array<uint64_t, 6> _r = {remainder[0], remainder[1], remainder[2], remainder[3], remainder[4], remainder[5]};
-    return fp(_r).toMont();
+    static_assert(N <= 12, "modPrime supports at most 768 bit inputs");
+    fp lo, hi, c;
+    for(size_t i = 0; i < 6; i++)
+    {
+        lo.d[i] = i < N ? k[i] : 0;
+        hi.d[i] = i + 6 < N ? k[i + 6] : 0;
+    }
+    _mul(&lo, &lo, &R2);
+    _mul(&hi, &hi, &R3);
+    _add(&c, &lo, &hi);
+    return c;
 }
 
 template<size_t N>
@@ -293,35 +332,37 @@ fp12 fp12::cyclotomicExp(const array<uint64_t, N>& s) const
 template<size_t N>
 g1 g1::mulScalar(const array<uint64_t, N>& s) const
 {
+    // left to right, so that the base is the addend: mixed additions if it is affine and one dblN per run of bits
     g1 q = g1({fp::zero(), fp::zero(), fp::zero()});
-    g1 n = *this;
-    uint64_t l = scalar::bitLength(s);
-    for(uint64_t i = 0; i < l; i++)
+    uint64_t run = 0;
+    for(uint64_t i = scalar::bitLength(s); i > 0; i--)
     {
-        if((s[i/64] >> (i%64) & 1) == 1)
+        run++;
+        if((s[(i-1)/64] >> ((i-1)%64) & 1) == 1)
         {
-            q = q.add(n);
+            q = q.dblN(run).addMixed(*this);
+            run = 0;
         }
-        n = n.dbl();
     }
-    return q;
+    return q.dblN(run);
 }
 
 template<size_t N>
 g2 g2::mulScalar(const array<uint64_t, N>& s) const
 {
+    // left to right, so that the base is the addend: mixed additions if it is affine and one dblN per run of bits
     g2 q = g2({fp2::zero(), fp2::zero(), fp2::zero()});
-    g2 n = *this;
-    uint64_t l = scalar::bitLength(s);
-    for(uint64_t i = 0; i < l; i++)
+    uint64_t run = 0;
+    for(uint64_t i = scalar::bitLength(s); i > 0; i--)
     {
-        if((s[i/64] >> (i%64) & 1) == 1)
+        run++;
+        if((s[(i-1)/64] >> ((i-1)%64) & 1) == 1)
         {
-            q = q.add(n);
+            q = q.dblN(run).addMixed(*this);
+            run = 0;
         }
-        n = n.dbl();
     }
-    return q;
+    return q.dblN(run);
 }
 
 template<size_t N>
@@ -2,7 +2,15 @@
 #include <cstdlib>
 #include <array>
 #include <vector>
+#include <span>
 #include <string>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_set>
+#include "cache.hpp"
 
 using namespace std;
 
@@ -11,6 +19,7 @@ namespace bls12_381
 
 class g1;
 class g2;
+class fp12;
 
 extern const string CIPHERSUITE_ID;
 extern const string POP_CIPHERSUITE_ID;
@@ -25,6 +34,45 @@ void xmd_sh256(
     int dst_len
 );
 
+// Domain separation context for expand_message_xmd (sha256): holds the sha256 midstate after the constant
+// 64 byte Z_pad prefix and the DST suffix (DST || I2OSP(len(DST), 1)) so they are not processed on every call.
+class hash_to_curve_context
+{
+
+public:
+    explicit hash_to_curve_context(const string& dst);
+    const string& dst() const;
+    // Same output as xmd_sh256 with this context's DST
+    void expandMessageXmd(uint8_t *buf, int buf_len, const uint8_t *in, int in_len) const;
+    // Expands every message to buf_len bytes at buf + i * buf_len. The messages are hashed in parallel SIMD lanes.
+    void expandMessageXmd(uint8_t *buf, int buf_len, span<const vector<uint8_t>> msgs) const;
+
+private:
+    string m_dst;
+    vector<uint8_t> m_dstPrime;
+    array<uint32_t, 8> m_zPadState;
+    // padded sha256 input of every b_i: 33 bytes left free for (b_0 xor b_(i-1)) || I2OSP(i, 1), then DST'
+    // and the sha256 padding, which are the same for all b_i
+    vector<uint8_t> m_biBlocks;
+};
+
+extern const hash_to_curve_context CIPHERSUITE_CONTEXT;
+extern const hash_to_curve_context POP_CIPHERSUITE_CONTEXT;
+
+// Hashed message H(m) in affine form and, if prepared, the Miller loop lines of H(m) in compact form
+struct hashed_message
+{
+    g2 point;
+    optional<array<array<fp2, 2>, 68>> lines;
+};
+typedef concurrent_cache<array<uint8_t, 32>, shared_ptr<const hashed_message>, bytes_hash> message_cache;
+
+// Process wide cache of hashed messages keyed by sha256(I2OSP(len(DST), 1) || DST || message), consulted by
+// sign, verify, aggregate_verify, pop_fast_aggregate_verify and batch_verify. Disabled (capacity 0) by default.
+// With 'prepared' the Miller loop lines of H(m) are cached too, which saves computing them on every verification.
+void configure_message_cache(const size_t capacity, const bool prepared = false);
+message_cache& hashed_message_cache();
+
 // Implements HMAC based on SHA256 as specified in RFC 2104: https://www.rfc-editor.org/rfc/rfc2104
 void hkdf256_hmac(
     uint8_t *mac,
@@ -120,14 +168,81 @@ bool verify(
     const g2& signature
 );
 
+// Public key that is validated (on curve, in the correct subgroup) once and stored in affine form together
+// with its compressed encoding. Verification with a prepared key skips the per-call checks and normalization.
+// Throws invalid_argument if the key is invalid.
+class public_key_prepared
+{
+
+public:
+    explicit public_key_prepared(const g1& pk);
+    static public_key_prepared fromCompressedBytesBE(const span<const uint8_t, 48> in);
+    const g1& point() const;
+    const array<uint8_t, 48>& compressed() const;
+
+private:
+    public_key_prepared(const g1& pk, const array<uint8_t, 48>& compressed);
+    g1 m_pk;
+    array<uint8_t, 48> m_compressed;
+};
+
+// Verify signature of a message using a prepared public key
+bool verify(
+    const public_key_prepared& pubkey,
+    const vector<uint8_t>& message,
+    const g2& signature
+);
+
 // Aggregate private keys
 array<uint64_t, 4> aggregate_secret_keys(const vector<array<uint64_t, 4>>& sks);
 
-// Aggregate public keys
+// Aggregate public keys. Large sets are summed up in parallel (per thread partial sums, mixed additions
+// for affine inputs). The compressed variant decompresses in the same parallel pass and throws
+// invalid_argument if an encoding is invalid.
 g1 aggregate_public_keys(const vector<g1>& pks);
+g1 aggregate_public_keys(span<const g1> pks);
+g1 aggregate_public_keys(span<const g1_affine> pks);
+g1 aggregate_public_keys(span<const array<uint8_t, 48>> pks);
 
-// Aggregate signatures
+// Aggregate signatures (same as above)
 g2 aggregate_signatures(const vector<g2>& sigs);
+g2 aggregate_signatures(span<const g2> sigs);
+g2 aggregate_signatures(span<const g2_affine> sigs);
+g2 aggregate_signatures(span<const array<uint8_t, 96>> sigs);
+
+// Thread-safe accumulator for public keys or signatures (G = g1 or g2) that arrive one by one. Points are added
+// to one of several independently locked shards, picked by the calling thread, so concurrent adds rarely
+// contend. Snapshots lock one shard at a time and never stop ingestion (they may miss concurrent adds).
+// Adds with a signer index count every signer only once.
+template<typename G>
+class aggregator
+{
+
+public:
+    explicit aggregator(const size_t numShards = 16);
+    void add(const G& p);
+    // Returns false (and ignores p) if the signer has already been added
+    bool add(const size_t signer, const G& p);
+    // Adds everything 'other' has accumulated. Throws invalid_argument if both contain the same signer or if
+    // 'other' is this aggregator.
+    void merge(const aggregator& other);
+    void clear();
+
+    G aggregate() const;
+    G affine() const;
+    decltype(G().toCompressedBytesBE()) toCompressedBytesBE() const;
+    uint64_t count() const;
+
+private:
+    struct shard
+    {
+        mutable mutex m;
+        G sum;
+        uint64_t count;
+        unordered_set<size_t> signers;
+    };
+    vector<unique_ptr<shard>> m_shards;
+};
 
 // Aggregate verify using a set of public keys, a set of messages and an aggregated signature
 // the boolean parameter enables an additional check for dublicate messages (possible attack
@@ -140,6 +255,43 @@ bool aggregate_verify(
     const bool checkForDuplicateMessages = false
 );
 
+// Same as above with prepared public keys
+bool aggregate_verify(
+    const vector<public_key_prepared>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const g2& signature,
+    const bool checkForDuplicateMessages = false
+);
+
+// Sharded aggregate verify, part 1: computes the partial Miller loop product of a subset of the
+// (public key, message) pairs. The partial can be serialized with fp12::toBytesBE and sent to the
+// party that runs 'aggregate_verify_combine'. Returns false if a public key is invalid.
+// Note: duplicate messages across shards can not be detected here.
+bool aggregate_verify_partial(
+    fp12& partial,
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages
+);
+
+// Sharded aggregate verify, part 2: combines the partial products of all shards with the
+// aggregated signature and checks the result with a single final exponentiation.
+bool aggregate_verify_combine(
+    const vector<fp12>& partials,
+    const g2& signature
+);
+
+// Batch verify n independently signed messages: each (pubkeys[i], messages[i], signatures[i])
+// triple must be valid. The triples are weighted with random 64 bit coefficients so that all of
+// them can be checked with a single (n+1)-pairing and one final exponentiation. Returns false if
+// at least one triple is invalid. If 'invalid' is given, it receives the sorted indices of all
+// invalid triples, localized by bisection over the already computed per-pair Miller loop products.
+bool batch_verify(
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const vector<g2>& signatures,
+    vector<size_t>* invalid = nullptr
+);
+
 // Create new BLS private key from bytes. Enable modulo division to ensure scalar is element of the field
 array<uint64_t, 4> sk_from_bytes(
     const array<uint8_t, 32>& in,
@@ -163,4 +315,67 @@ bool pop_fast_aggregate_verify(
     const g2& signature
 );
 
+// Fixed committee of public keys with their precomputed sum. The aggregate public key of a participation subset
+// is computed from the members that are absent (total - sum of absent keys) or present, whichever are fewer, so
+// that it costs O(min(absent, present)) additions instead of O(committee). Replacing a member costs O(1).
+class committee
+{
+
+public:
+    explicit committee(const vector<g1>& pubkeys);
+    size_t size() const;
+    g1 member(const size_t index) const;
+    const g1& aggregate() const;
+    g1 aggregate(const vector<bool>& participation) const;
+    void update(const size_t index, const g1& pubkey);
+
+private:
+    vector<g1_affine> m_members;
+    g1 m_total;
+};
+
+// pop_fast_aggregate_verify for the participating members of a committee
+bool pop_fast_aggregate_verify(
+    const committee& members,
+    const vector<bool>& participation,
+    const vector<uint8_t>& message,
+    const g2& signature
+);
+
+// Opt-in cache of successful verifications, e.g. for triples that are received from many gossip peers. Keyed by
+// the sha256 digest of the (public key, message, signature) triple; only positive results are recorded and
+// entries expire after 'ttl'.
+class verification_cache
+{
+
+public:
+    verification_cache(const size_t capacity, const chrono::steady_clock::duration ttl, const size_t numShards = 16);
+    bool contains(const array<uint8_t, 32>& key);
+    void insert(const array<uint8_t, 32>& key);
+    void clear();
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    concurrent_cache<array<uint8_t, 32>, chrono::steady_clock::time_point, bytes_hash> m_entries;
+    chrono::steady_clock::duration m_ttl;
+    atomic<uint64_t> m_hits;
+    atomic<uint64_t> m_misses;
+};
+
+// verify and pop_verify that skip triples which have already been verified successfully
+bool verify(
+    const g1& pubkey,
+    const vector<uint8_t>& message,
+    const g2& signature,
+    verification_cache& cache
+);
+
+bool pop_verify(
+    const g1& pubkey,
+    const g2& signature_proof,
+    verification_cache& cache
+);
+
 } // namespace bls12_381
\ No newline at end of file
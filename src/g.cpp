@@ -1,4 +1,5 @@
 #include "../include/bls12_381.hpp"
+#include "thread_pool.hpp"
 
 namespace bls12_381
 {
@@ -15,6 +16,20 @@ g1::g1(const g1& e) : x(e.x), y(e.y), z(e.z)
 {
 }
 
+g1::g1(const g1_affine& e) : x(e.x), y(e.y), z(e.infinity ? fp::zero() : fp::one())
+{
+}
+
+g1::g1(const g1_projective& e)
+{
+    // (X : Y : Z) -> (X*Z, Y*Z^2, Z); the point at infinity keeps z = 0
+    fp t;
+    _mul(&x, &e.x, &e.z);
+    _square(&t, &e.z);
+    _mul(&y, &e.y, &t);
+    z = e.z;
+}
+
 g1 g1::fromJacobianBytesBE(const span<const uint8_t, 144> in, const bool check)
 {
     fp x = fp::fromBytesBE(span<const uint8_t, 48>(&in[ 0], &in[ 48]));
@@ -88,6 +103,21 @@ g1 g1::fromCompressedBytesBE(const span<const uint8_t, 48> in)
     return p;
 }
 
+g1 g1::fromCompressedBytesBE(const span<const uint8_t, 48> in, g1_cache& cache)
+{
+    array<uint8_t, 48> key;
+    copy(in.begin(), in.end(), key.begin());
+    return cache.findOrInsert(key, [&in]()
+    {
+        g1 p = fromCompressedBytesBE(in);
+        if(!p.inCorrectSubgroup())
+        {
+            throw invalid_argument("point is not in the correct subgroup");
+        }
+        return p;
+    });
+}
+
 void g1::toJacobianBytesBE(const span<uint8_t, 144> out) const
 {
     memcpy(&out[ 0], &x.toBytesBE()[0], 48);
@@ -261,6 +291,45 @@ g1 g1::affine() const
     return r;
 }
 
+// Converts all points to affine form using a single field inversion (Montgomery's trick)
+void g1::batchAffine(span<g1> points)
+{
+    vector<fp> acc;
+    acc.reserve(points.size());
+    fp t = fp::one();
+    for(const g1& p : points)
+    {
+        if(!p.isZero() && !p.isAffine())
+        {
+            acc.push_back(t);
+            _mul(&t, &t, &p.z);
+        }
+    }
+    if(acc.size() == 0)
+    {
+        return;
+    }
+    t = t.inverse();
+    fp zInv, zInv2;
+    for(int64_t i = points.size() - 1; i >= 0; i--)
+    {
+        g1& p = points[i];
+        if(p.isZero() || p.isAffine())
+        {
+            continue;
+        }
+        // t = (z_0 * ... * z_i)^-1 and acc = z_0 * ... * z_{i-1}
+        _mul(&zInv, &t, &acc.back());
+        _mul(&t, &t, &p.z);
+        acc.pop_back();
+        _square(&zInv2, &zInv);
+        _mul(&p.x, &p.x, &zInv2);
+        _mul(&zInv2, &zInv2, &zInv);
+        _mul(&p.y, &p.y, &zInv2);
+        p.z = fp::one();
+    }
+}
+
 g1 g1::add(const g1& e) const
 {
     g1 b = e;
@@ -315,6 +384,64 @@ g1 g1::add(const g1& e) const
     return r;
 }
 
+g1 g1::addMixed(const g1& e) const
+{
+    if(!e.isAffine())
+    {
+        return add(e);
+    }
+    return addMixed(g1_affine(e.x, e.y));
+}
+
+g1 g1::addMixed(const g1_affine& e) const
+{
+    // www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#addition-madd-2007-bl
+    if(e.infinity)
+    {
+        return *this;
+    }
+    if(isZero())
+    {
+        return g1(e);
+    }
+    fp t[8];
+    _square(&t[0], &z);             // Z1Z1 = Z1^2
+    _mul(&t[1], &e.x, &t[0]);       // U2 = X2*Z1Z1
+    _mul(&t[2], &z, &t[0]);
+    _mul(&t[2], &e.y, &t[2]);       // S2 = Y2*Z1*Z1Z1
+    if(t[1].equal(x))
+    {
+        if(t[2].equal(y))
+        {
+            return dbl();
+        }
+        return zero();
+    }
+    g1 r;
+    _sub(&t[3], &t[1], &x);         // H = U2-X1
+    _square(&t[4], &t[3]);          // HH = H^2
+    _double(&t[5], &t[4]);
+    _double(&t[5], &t[5]);          // I = 4*HH
+    _mul(&t[6], &t[3], &t[5]);      // J = H*I
+    _sub(&t[2], &t[2], &y);
+    _double(&t[2], &t[2]);          // r = 2*(S2-Y1)
+    _mul(&t[7], &x, &t[5]);         // V = X1*I
+    _square(&r.x, &t[2]);
+    _sub(&r.x, &r.x, &t[6]);
+    _sub(&r.x, &r.x, &t[7]);
+    _sub(&r.x, &r.x, &t[7]);        // X3 = r^2-J-2*V
+    _sub(&t[7], &t[7], &r.x);
+    _mul(&t[7], &t[2], &t[7]);
+    _mul(&t[6], &y, &t[6]);
+    _double(&t[6], &t[6]);
+    _sub(&r.y, &t[7], &t[6]);       // Y3 = r*(V-X3)-2*Y1*J
+    _add(&r.z, &z, &t[3]);
+    _square(&r.z, &r.z);
+    _sub(&r.z, &r.z, &t[0]);
+    _sub(&r.z, &r.z, &t[4]);        // Z3 = (Z1+H)^2-Z1Z1-HH
+    return r;
+}
+
 g1 g1::dbl() const
 {
     // http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#doubling-dbl-2009-l
@@ -349,6 +476,42 @@ g1 g1::dbl() const
     return r;
 }
 
+g1 g1::dblN(const uint64_t n) const
+{
+    // dbl-2009-l in place, without the temporaries and zero checks of n calls to dbl()
+    if(isZero())
+    {
+        return *this;
+    }
+    fp t[5];
+    g1 r = *this;
+    for(uint64_t i = 0; i < n; i++)
+    {
+        _square(&t[0], &r.x);           // A = X1^2
+        _square(&t[1], &r.y);           // B = Y1^2
+        _square(&t[2], &t[1]);          // C = B^2
+        _add(&t[1], &r.x, &t[1]);
+        _square(&t[1], &t[1]);
+        _sub(&t[1], &t[1], &t[0]);
+        _sub(&t[1], &t[1], &t[2]);
+        _double(&t[1], &t[1]);          // D = 2*((X1+B)^2-A-C)
+        _double(&t[3], &t[0]);
+        _add(&t[0], &t[3], &t[0]);      // E = 3*A
+        _mul(&r.z, &r.y, &r.z);
+        _double(&r.z, &r.z);            // Z3 = 2*Y1*Z1
+        _square(&t[4], &t[0]);          // F = E^2
+        _double(&t[3], &t[1]);
+        _sub(&r.x, &t[4], &t[3]);       // X3 = F-2*D
+        _sub(&t[1], &t[1], &r.x);
+        _double(&t[2], &t[2]);
+        _double(&t[2], &t[2]);
+        _double(&t[2], &t[2]);
+        _mul(&t[0], &t[0], &t[1]);
+        _sub(&r.y, &t[0], &t[2]);       // Y3 = E*(D-X3)-8*C
+    }
+    return r;
+}
+
 g1 g1::neg() const
 {
     g1 r;
@@ -374,8 +537,21 @@ g1 g1::clearCofactor() const
 // MultiExp calculates multi exponentiation. Given pairs of G1 point and scalar values
 // (P_0, e_0), (P_1, e_1), ... (P_n, e_n) calculates r = e_0 * P_0 + e_1 * P_1 + ... + e_n * P_n
 // Length of points and scalars are expected to be equal, otherwise an error is returned.
+// If all scalars are known to be short, 'numBits' limits the number of windows processed.
 // Result is assigned to point at first argument.
-g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers)
+g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits)
+{
+    if(points.size() != powers.size())
+    {
+        throw invalid_argument("point and scalar vectors must have same length!");
+    }
+    // every point is added once per window: normalize them so that those are all mixed additions
+    const vector<g1_affine> bases = g1_affine::fromJacobian(points);
+    return multiExp(bases, powers, numBits);
+}
+
+// Same as above with the points already in affine form
+g1 g1::multiExp(span<const g1_affine> points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits)
 {
     if(points.size() != powers.size())
     {
@@ -387,7 +563,6 @@ g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers)
         c = static_cast<uint64_t>(ceil(log10(static_cast<double>(powers.size()))));
     }
     uint64_t bucketSize = (1<<c)-1;
-    uint64_t numBits = 255;
     vector<g1> windows;
     windows.reserve(numBits/c+1);
     vector<g1> bucket;
@@ -412,7 +587,7 @@ g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers)
             uint64_t index = s0 & mask;
             if(index != 0)
             {
-                bucket[index-1] = bucket[index-1].add(points[i]);
+                bucket[index-1] = bucket[index-1].addMixed(points[i]);
             }
             scalar::rsh(powers[i], c);
         }
@@ -428,11 +603,7 @@ g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers)
     acc = zero();
     for(int64_t i = windows.size() - 1; i >= 0; i--)
     {
-        for(j = 0; j < c; j++)
-        {
-            acc = acc.dbl();
-        }
-        acc = acc.add(windows[i]);
+        acc = acc.dblN(c).add(windows[i]);
     }
     return acc;
 }
@@ -444,82 +615,98 @@ g1 g1::multiExp(const vector<g1>& points, vector<array<uint64_t, 4>>& powers)
 g1 g1::mapToCurve(const array<uint8_t, 48>& in)
 {
     fp u = fp::fromBytesBE(in);
-    fp x, y;
-    tie(x, y) = swuMapG1(u);
-    isogenyMapG1(x, y);
-    fp z = fp::one();
-    g1 p({x, y, z});
+    fp xNum, xDen, y;
+    tie(xNum, xDen, y) = swuMapG1(u);
+    g1 p = isogenyMapG1(xNum, xDen, y);
     p = p.clearCofactor();
     return p.affine();
 }
 
-tuple<fp, fp> g1::swuMapG1(const fp& e)
+// sqrt_ratio for p = 3 mod 4 (RFC 9380, appendix F.2.1.2). Returns whether u/v is square and sets
+// y = sqrt(u/v) if it is or y = sqrt(Z * u/v) otherwise.
+static bool sqrtRatio(fp& y, const fp& u, const fp& v)
+{
+    // c2 = sqrt(-Z)
+    static const fp c2 = fp({0xf37b0ced8fb71e24, 0xf02dc8a4535a8779, 0x732ed835f7eb14ea, 0x524ca41ecb2bce0d, 0x095e3801e90b5fc1, 0x0252ad055472a90e});
+    fp tv[3], y1, y2;
+    _square(&tv[0], &v);
+    _mul(&tv[1], &u, &v);
+    _mul(&tv[0], &tv[0], &tv[1]);
+    y1 = tv[0].exp(fp::pMinus3Over4);
+    _mul(&y1, &y1, &tv[1]);
+    _mul(&y2, &y1, &c2);
+    _square(&tv[2], &y1);
+    _mul(&tv[2], &tv[2], &v);
+    bool isQR = tv[2].equal(u);
+    y = isQR ? y1 : y2;
+    return isQR;
+}
+
+// swuMapG1 implements the simplified SWU map onto the 11-isogenous curve E' (RFC 9380, section 6.6.2 and
+// appendix F.2). It needs no inversion: the result is returned as x = xNum / xDen and y.
+tuple<fp, fp, fp> g1::swuMapG1(const fp& e)
 {
-    struct swuParamsForG1
+    static const struct swuParamsForG1
     {
         fp z;
-        fp zInv;
         fp a;
         fp b;
-        fp minusBOverA;
     } params = {
         fp({0x886c00000023ffdc, 0x0f70008d3090001d, 0x77672417ed5828c3, 0x9dac23e943dc1740, 0x50553f1b9c131521, 0x078c712fbe0ab6e8}),
-        fp({0x0e8a2e8ba2e83e10, 0x5b28ba2ca4d745d1, 0x678cd5473847377a, 0x4c506dd8a8076116, 0x9bcb227d79284139, 0x0e8d3154b0ba099a}),
         fp({0x2f65aa0e9af5aa51, 0x86464c2d1e8416c3, 0xb85ce591b7bd31e2, 0x27e11c91b5f24e7c, 0x28376eda6bfc1835, 0x155455c3e5071d85}),
         fp({0xfb996971fe22a1e0, 0x9aa93eb35b742d6f, 0x8c476013de99c5c4, 0x873e27c3a221e571, 0xca72b5e45a52d888, 0x06824061418a386b}),
-        fp({0x052583c93555a7fe, 0x3b40d72430f93c82, 0x1b75faa0105ec983, 0x2527e7dc63851767, 0x99fffd1f34fc181d, 0x097cab54770ca0d3})
     };
-    fp tv[4];
+    fp tv[6];
     fp u = e;
+    fp one = fp::one();
     _square(&tv[0], &u);
-    _mul(&tv[0], &tv[0], &params.z);
+    _mul(&tv[0], &params.z, &tv[0]);
     _square(&tv[1], &tv[0]);
-    fp x1;
-    _add(&x1, &tv[0], &tv[1]);
-    x1 = x1.inverse();
-    bool e1 = x1.isZero();
-    fp one = fp::one();
-    _add(&x1, &x1, &one);
-    if(e1)
-    {
-        x1 = params.zInv;
-    }
-    _mul(&x1, &x1, &params.minusBOverA);
-    fp gx1;
-    _square(&gx1, &x1);
-    _add(&gx1, &gx1, &params.a);
-    _mul(&gx1, &gx1, &x1);
-    _add(&gx1, &gx1, &params.b);
-    fp x2;
-    _mul(&x2, &tv[0], &x1);
-    _mul(&tv[1], &tv[0], &tv[1]);
-    fp gx2;
-    _mul(&gx2, &gx1, &tv[1]);
-    bool e2 = !gx1.isQuadraticNonResidue();
-    fp x, y2;
-    if(e2)
-    {
-        x = x1;
-        y2 = gx1;
+    _add(&tv[1], &tv[1], &tv[0]);
+    _add(&tv[2], &tv[1], &one);
+    _mul(&tv[2], &params.b, &tv[2]);
+    // x denominator
+    if(tv[1].isZero())
+    {
+        tv[3] = params.z;
     }
     else
     {
-        x = x2;
-        y2 = gx2;
+        _neg(&tv[3], &tv[1]);
+    }
+    _mul(&tv[3], &params.a, &tv[3]);
+    // g(x1) = tv[1] / tv[5]
+    _square(&tv[1], &tv[2]);
+    _square(&tv[5], &tv[3]);
+    _mul(&tv[4], &params.a, &tv[5]);
+    _add(&tv[1], &tv[1], &tv[4]);
+    _mul(&tv[1], &tv[1], &tv[2]);
+    _mul(&tv[5], &tv[5], &tv[3]);
+    _mul(&tv[4], &params.b, &tv[5]);
+    _add(&tv[1], &tv[1], &tv[4]);
+    fp x, y, y1;
+    _mul(&x, &tv[0], &tv[2]);
+    bool isGx1Square = sqrtRatio(y1, tv[1], tv[5]);
+    _mul(&y, &tv[0], &u);
+    _mul(&y, &y, &y1);
+    if(isGx1Square)
+    {
+        x = tv[2];
+        y = y1;
     }
-    fp y;
-    y2.sqrt(y);
     if(y.sign() != u.sign())
     {
         _neg(&y, &y);
     }
-    return {x, y};
+    return {x, tv[3], y};
 }
 
-void g1::isogenyMapG1(fp& x, fp& y)
+// isogenyMapG1 evaluates the 11-isogeny from E' to E (RFC 9380, appendix E.2) at x = xNum / xDen. The rational maps
+// are homogenized in xNum and xDen, so the result is returned in jacobian coordinates without any inversion.
+g1 g1::isogenyMapG1(const fp& xNum, const fp& xDen, const fp& y)
 {
     // https://tools.ietf.org/html/draft-irtf-cfrg-hash-to-curve-06#appendix-C.2
-    fp isogenyConstantsG1[4][16] = {
+    static const fp isogenyConstantsG1[4][16] = {
         {
             fp({0x4d18b6f3af00131c, 0x19fa219793fee28c, 0x3f2885f1467f19ae, 0x23dcea34f2ffb304, 0xd15b58d2ffc00054, 0x0913be200a20bef4}),
             fp({0x898985385cdbbd8b, 0x3c79e43cc7d966aa, 0x1597e193f4cd233a, 0x8637ef1e4d6623ad, 0x11b22deed20d827b, 0x07097bc5998784ad}),
@@ -593,31 +780,41 @@ void g1::isogenyMapG1(fp& x, fp& y)
             fp({0x760900000002fffd, 0xebf4000bc40c0002, 0x5f48985753c758ba, 0x77ce585370525745, 0x5c071a97a256ec6d, 0x15f65ec3fa80e493}),
         }
     };
-    fp (*params)[16] = isogenyConstantsG1;
-    int64_t degree = 15;
-    fp xNum, xDen, yNum, yDen;
-    xNum = params[0][degree];
-    xDen = params[1][degree];
-    yNum = params[2][degree];
-    yDen = params[3][degree];
-    for(int64_t i = degree - 1; i >= 0; i--)
-    {
-        _mul(&xNum, &xNum, &x);
-        _mul(&xDen, &xDen, &x);
-        _mul(&yNum, &yNum, &x);
-        _mul(&yDen, &yDen, &x);
-        _add(&xNum, &xNum, &params[0][i]);
-        _add(&xDen, &xDen, &params[1][i]);
-        _add(&yNum, &yNum, &params[2][i]);
-        _add(&yDen, &yDen, &params[3][i]);
-    }
-    xDen = xDen.inverse();
-    yDen = yDen.inverse();
-    _mul(&xNum, &xNum, &xDen);
-    _mul(&yNum, &yNum, &yDen);
-    _mul(&yNum, &yNum, &y);
-    x = xNum;
-    y = yNum;
+    const fp (*params)[16] = isogenyConstantsG1;
+    const int64_t degree = 15;
+    fp xDenPow[degree + 1];
+    xDenPow[0] = fp::one();
+    for(int64_t i = 1; i <= degree; i++)
+    {
+        _mul(&xDenPow[i], &xDenPow[i - 1], &xDen);
+    }
+    // n[0] = x numerator, n[1] = x denominator, n[2] = y numerator, n[3] = y denominator
+    fp n[4], t;
+    for(int64_t k = 0; k < 4; k++)
+    {
+        n[k] = params[k][degree];
+        for(int64_t i = degree - 1; i >= 0; i--)
+        {
+            _mul(&n[k], &n[k], &xNum);
+            if(!params[k][i].isZero())
+            {
+                _mul(&t, &params[k][i], &xDenPow[degree - i]);
+                _add(&n[k], &n[k], &t);
+            }
+        }
+    }
+    g1 q;
+    // Z = Dx * Dy
+    _mul(&q.z, &n[1], &n[3]);
+    // X = Nx * Dy * Z
+    _mul(&q.x, &n[0], &n[3]);
+    _mul(&q.x, &q.x, &q.z);
+    // Y = y * Ny * Dx * Z^2
+    _square(&t, &q.z);
+    _mul(&q.y, &y, &n[2]);
+    _mul(&q.y, &q.y, &n[1]);
+    _mul(&q.y, &q.y, &t);
+    return q;
 }
 
 const g1 g1::BASE = g1({
@@ -628,6 +825,320 @@ const g1 g1::BASE = g1({
 
 const array<uint64_t, 1> g1::cofactorEFF = {0xd201000000010001};
 
+g1_affine::g1_affine() : x(fp::zero()), y(fp::zero()), infinity(true)
+{
+}
+
+g1_affine::g1_affine(const fp& x, const fp& y) : x(x), y(y), infinity(false)
+{
+}
+
+g1_affine::g1_affine(const g1& e) : infinity(e.isZero())
+{
+    if(infinity)
+    {
+        x = fp::zero();
+        y = fp::zero();
+        return;
+    }
+    const g1 a = e.affine();
+    x = a.x;
+    y = a.y;
+}
+
+vector<g1_affine> g1_affine::fromJacobian(span<const g1> points)
+{
+    vector<g1> a(points.begin(), points.end());
+    g1::batchAffine(a);
+    vector<g1_affine> r;
+    r.reserve(a.size());
+    for(const g1& p : a)
+    {
+        r.push_back(p.isZero() ? zero() : g1_affine(p.x, p.y));
+    }
+    return r;
+}
+
+g1_affine g1_affine::fromCompressedBytesBE(const span<const uint8_t, 48> in)
+{
+    return g1_affine(g1::fromCompressedBytesBE(in));
+}
+
+array<uint8_t, 48> g1_affine::toCompressedBytesBE() const
+{
+    return g1(*this).toCompressedBytesBE();
+}
+
+g1_affine g1_affine::zero()
+{
+    return g1_affine();
+}
+
+bool g1_affine::isZero() const
+{
+    return infinity;
+}
+
+bool g1_affine::equal(const g1_affine& e) const
+{
+    if(infinity || e.infinity)
+    {
+        return infinity == e.infinity;
+    }
+    return x.equal(e.x) && y.equal(e.y);
+}
+
+bool g1_affine::inCorrectSubgroup() const
+{
+    return g1(*this).inCorrectSubgroup();
+}
+
+bool g1_affine::isOnCurve() const
+{
+    return g1(*this).isOnCurve();
+}
+
+g1_affine g1_affine::neg() const
+{
+    g1_affine r = *this;
+    if(!infinity)
+    {
+        _neg(&r.y, &y);
+    }
+    return r;
+}
+
+// Sets r to a if mask is all ones and to b if it is zero
+static void cselect(fp& r, const fp& a, const fp& b, const uint64_t mask)
+{
+    for(size_t i = 0; i < 6; i++)
+    {
+        r.d[i] = (a.d[i] & mask) | (b.d[i] & ~mask);
+    }
+}
+
+static void cselect(fp2& r, const fp2& a, const fp2& b, const uint64_t mask)
+{
+    cselect(r.c0, a.c0, b.c0, mask);
+    cselect(r.c1, a.c1, b.c1, mask);
+}
+
+// z = 3 * b * x = 12 * x
+static void mulBy3b(fp* z, const fp* x)
+{
+    fp t;
+    _double(&t, x);
+    _add(&t, &t, x);
+    _double(&t, &t);
+    _double(z, &t);
+}
+
+g1_projective::g1_projective() : x(fp::zero()), y(fp::one()), z(fp::zero())
+{
+}
+
+g1_projective::g1_projective(const g1& e)
+{
+    // (x, y, z) -> (x*z, y, z^3)
+    if(e.isZero())
+    {
+        *this = zero();
+        return;
+    }
+    fp t;
+    _mul(&x, &e.x, &e.z);
+    y = e.y;
+    _square(&t, &e.z);
+    _mul(&z, &t, &e.z);
+}
+
+g1_projective::g1_projective(const g1_affine& e) : x(e.x), y(e.y), z(fp::one())
+{
+    if(e.infinity)
+    {
+        *this = zero();
+    }
+}
+
+g1 g1_projective::affine() const
+{
+    if(isZero())
+    {
+        return g1::zero();
+    }
+    fp t;
+    g1 r;
+    t = z.inverseConstTime();
+    _mul(&r.x, &x, &t);
+    _mul(&r.y, &y, &t);
+    r.z = fp::one();
+    return r;
+}
+
+g1_projective g1_projective::zero()
+{
+    return g1_projective();
+}
+
+bool g1_projective::isZero() const
+{
+    return z.isZero();
+}
+
+bool g1_projective::equal(const g1_projective& e) const
+{
+    // X1*Z2 == X2*Z1 and Y1*Z2 == Y2*Z1, which also covers the point at infinity
+    fp t[4];
+    _mul(&t[0], &x, &e.z);
+    _mul(&t[1], &e.x, &z);
+    _mul(&t[2], &y, &e.z);
+    _mul(&t[3], &e.y, &z);
+    return t[0].equal(t[1]) && t[2].equal(t[3]);
+}
+
+g1_projective g1_projective::add(const g1_projective& e) const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 7
+    fp t[5];
+    g1_projective r;
+    _mul(&t[0], &x, &e.x);          // t0 = X1*X2
+    _mul(&t[1], &y, &e.y);          // t1 = Y1*Y2
+    _mul(&t[2], &z, &e.z);          // t2 = Z1*Z2
+    _add(&t[3], &x, &y);
+    _add(&t[4], &e.x, &e.y);
+    _mul(&t[3], &t[3], &t[4]);
+    _add(&t[4], &t[0], &t[1]);
+    _sub(&t[3], &t[3], &t[4]);      // t3 = X1*Y2+X2*Y1
+    _add(&t[4], &y, &z);
+    _add(&r.x, &e.y, &e.z);
+    _mul(&t[4], &t[4], &r.x);
+    _add(&r.x, &t[1], &t[2]);
+    _sub(&t[4], &t[4], &r.x);       // t4 = Y1*Z2+Y2*Z1
+    _add(&r.x, &x, &z);
+    _add(&r.y, &e.x, &e.z);
+    _mul(&r.x, &r.x, &r.y);
+    _add(&r.y, &t[0], &t[2]);
+    _sub(&r.y, &r.x, &r.y);         // Y3 = X1*Z2+X2*Z1
+    _double(&r.x, &t[0]);
+    _add(&t[0], &r.x, &t[0]);       // t0 = 3*X1*X2
+    mulBy3b(&t[2], &t[2]);
+    _add(&r.z, &t[1], &t[2]);
+    _sub(&t[1], &t[1], &t[2]);
+    mulBy3b(&r.y, &r.y);
+    _mul(&r.x, &t[4], &r.y);
+    _mul(&t[2], &t[3], &t[1]);
+    _sub(&r.x, &t[2], &r.x);        // X3 = t3*t1-t4*Y3
+    _mul(&r.y, &r.y, &t[0]);
+    _mul(&t[1], &t[1], &r.z);
+    _add(&r.y, &t[1], &r.y);        // Y3 = t1*Z3+t0*Y3
+    _mul(&t[0], &t[0], &t[3]);
+    _mul(&r.z, &r.z, &t[4]);
+    _add(&r.z, &r.z, &t[0]);        // Z3 = t4*Z3+t0*t3
+    return r;
+}
+
+g1_projective g1_projective::addMixed(const g1_affine& e) const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 8; the infinity flag is applied with a select at the end
+    fp t[5];
+    g1_projective r;
+    _mul(&t[0], &x, &e.x);          // t0 = X1*X2
+    _mul(&t[1], &y, &e.y);          // t1 = Y1*Y2
+    _add(&t[3], &e.x, &e.y);
+    _add(&t[4], &x, &y);
+    _mul(&t[3], &t[3], &t[4]);
+    _add(&t[4], &t[0], &t[1]);
+    _sub(&t[3], &t[3], &t[4]);      // t3 = X1*Y2+X2*Y1
+    _mul(&t[4], &e.y, &z);
+    _add(&t[4], &t[4], &y);         // t4 = Y2*Z1+Y1
+    _mul(&r.y, &e.x, &z);
+    _add(&r.y, &r.y, &x);           // Y3 = X2*Z1+X1
+    _double(&r.x, &t[0]);
+    _add(&t[0], &r.x, &t[0]);       // t0 = 3*X1*X2
+    mulBy3b(&t[2], &z);
+    _add(&r.z, &t[1], &t[2]);
+    _sub(&t[1], &t[1], &t[2]);
+    mulBy3b(&r.y, &r.y);
+    _mul(&r.x, &t[4], &r.y);
+    _mul(&t[2], &t[3], &t[1]);
+    _sub(&r.x, &t[2], &r.x);        // X3 = t3*t1-t4*Y3
+    _mul(&r.y, &r.y, &t[0]);
+    _mul(&t[1], &t[1], &r.z);
+    _add(&r.y, &t[1], &r.y);        // Y3 = t1*Z3+t0*Y3
+    _mul(&t[0], &t[0], &t[3]);
+    _mul(&r.z, &r.z, &t[4]);
+    _add(&r.z, &r.z, &t[0]);        // Z3 = t4*Z3+t0*t3
+    return select(e.infinity, *this, r);
+}
+
+g1_projective g1_projective::dbl() const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 9
+    fp t[3];
+    g1_projective r;
+    _square(&t[0], &y);             // t0 = Y^2
+    _double(&r.z, &t[0]);
+    _double(&r.z, &r.z);
+    _double(&r.z, &r.z);            // Z3 = 8*Y^2
+    _mul(&t[1], &y, &z);            // t1 = Y*Z
+    _square(&t[2], &z);
+    mulBy3b(&t[2], &t[2]);          // t2 = 3*b*Z^2
+    _mul(&r.x, &t[2], &r.z);
+    _add(&r.y, &t[0], &t[2]);
+    _mul(&r.z, &t[1], &r.z);        // Z3 = 8*Y^3*Z
+    _double(&t[1], &t[2]);
+    _add(&t[2], &t[1], &t[2]);
+    _sub(&t[0], &t[0], &t[2]);      // t0 = Y^2-9*b*Z^2
+    _mul(&r.y, &t[0], &r.y);
+    _add(&r.y, &r.x, &r.y);         // Y3 = t0*(Y^2+3*b*Z^2)+24*b*Y^2*Z^2
+    _mul(&t[1], &x, &y);
+    _mul(&r.x, &t[0], &t[1]);
+    _double(&r.x, &r.x);            // X3 = 2*t0*X*Y
+    return r;
+}
+
+g1_projective g1_projective::neg() const
+{
+    g1_projective r = *this;
+    _neg(&r.y, &y);
+    return r;
+}
+
+g1_projective g1_projective::select(const bool c, const g1_projective& a, const g1_projective& b)
+{
+    const uint64_t mask = 0 - static_cast<uint64_t>(c);
+    g1_projective r;
+    cselect(r.x, a.x, b.x, mask);
+    cselect(r.y, a.y, b.y, mask);
+    cselect(r.z, a.z, b.z, mask);
+    return r;
+}
+
+g1_projective g1_projective::mulScalar(const array<uint64_t, 4>& s) const
+{
+    // fixed 4 bit windows: the multiple for each window is read from the table with a full scan of selects,
+    // so neither the memory accesses nor the sequence of additions depend on s
+    array<g1_projective, 16> table;
+    table[1] = *this;
+    for(size_t j = 2; j < 16; j++)
+    {
+        table[j] = table[j-1].add(*this);
+    }
+    g1_projective q = zero();
+    for(int64_t w = 63; w >= 0; w--)
+    {
+        q = q.dbl().dbl().dbl().dbl();
+        const uint64_t bits = (s[w/16] >> ((w%16)*4)) & 0xf;
+        g1_projective t = zero();
+        for(uint64_t j = 1; j < 16; j++)
+        {
+            t = select(j == bits, table[j], t);
+        }
+        q = q.add(t);
+    }
+    return q;
+}
+
 g2::g2() : x(fp2()), y(fp2()), z(fp2())
 {
 }
@@ -640,6 +1151,15 @@ g2::g2(const g2& e) : x(e.x), y(e.y), z(e.z)
 {
 }
 
+g2::g2(const g2_affine& e) : x(e.x), y(e.y), z(e.infinity ? fp2::zero() : fp2::one())
+{
+}
+
+g2::g2(const g2_projective& e) : x(e.x.mul(e.z)), y(e.y.mul(e.z.square())), z(e.z)
+{
+    // (X : Y : Z) -> (X*Z, Y*Z^2, Z); the point at infinity keeps z = 0
+}
+
 g2 g2::fromJacobianBytesBE(const span<const uint8_t, 288> in, const bool check)
 {
     fp2 x = fp2::fromBytesBE(span<const uint8_t, 96>(&in[  0], &in[ 96]));
@@ -714,6 +1234,21 @@ g2 g2::fromCompressedBytesBE(const span<const uint8_t, 96> in)
     return p;
 }
 
+g2 g2::fromCompressedBytesBE(const span<const uint8_t, 96> in, g2_cache& cache)
+{
+    array<uint8_t, 96> key;
+    copy(in.begin(), in.end(), key.begin());
+    return cache.findOrInsert(key, [&in]()
+    {
+        g2 p = fromCompressedBytesBE(in);
+        if(!p.inCorrectSubgroup())
+        {
+            throw invalid_argument("point is not in the correct subgroup");
+        }
+        return p;
+    });
+}
+
 void g2::toJacobianBytesBE(const span<uint8_t, 288> out) const
 {
     memcpy(&out[  0], &x.toBytesBE()[0], 96);
@@ -888,6 +1423,45 @@ g2 g2::affine() const
     return r;
 }
 
+// Converts all points to affine form using a single field inversion (Montgomery's trick)
+void g2::batchAffine(span<g2> points)
+{
+    vector<fp2> acc;
+    acc.reserve(points.size());
+    fp2 t = fp2::one();
+    for(const g2& p : points)
+    {
+        if(!p.isZero() && !p.isAffine())
+        {
+            acc.push_back(t);
+            t.mulAssign(p.z);
+        }
+    }
+    if(acc.size() == 0)
+    {
+        return;
+    }
+    t = t.inverse();
+    fp2 zInv, zInv2;
+    for(int64_t i = points.size() - 1; i >= 0; i--)
+    {
+        g2& p = points[i];
+        if(p.isZero() || p.isAffine())
+        {
+            continue;
+        }
+        // t = (z_0 * ... * z_i)^-1 and acc = z_0 * ... * z_{i-1}
+        zInv = t.mul(acc.back());
+        t.mulAssign(p.z);
+        acc.pop_back();
+        zInv2 = zInv.square();
+        p.x.mulAssign(zInv2);
+        zInv2.mulAssign(zInv);
+        p.y.mulAssign(zInv2);
+        p.z = fp2::one();
+    }
+}
+
 g2 g2::add(const g2& e) const
 {
     g2 b = e;
@@ -942,19 +1516,64 @@ g2 g2::add(const g2& e) const
     return r;
 }
 
-g2 g2::dbl() const
+g2 g2::addMixed(const g2& e) const
 {
-    // http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#doubling-dbl-2009-l
-    if(isZero())
+    if(!e.isAffine())
+    {
+        return add(e);
+    }
+    return addMixed(g2_affine(e.x, e.y));
+}
+
+g2 g2::addMixed(const g2_affine& e) const
+{
+    // http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#addition-madd-2007-bl
+    if(e.infinity)
     {
         return *this;
     }
-    fp2 t[9];
-    g2 r;
-    t[0] = x.square();
-    t[1] = y.square();
-    t[2] = t[1].square();
-    t[1] = x.add(t[1]);
+    if(isZero())
+    {
+        return g2(e);
+    }
+    fp2 t[8];
+    t[0] = z.square();              // Z1Z1 = Z1^2
+    t[1] = e.x.mul(t[0]);           // U2 = X2*Z1Z1
+    t[2] = e.y.mul(z.mul(t[0]));    // S2 = Y2*Z1*Z1Z1
+    if(t[1].equal(x))
+    {
+        if(t[2].equal(y))
+        {
+            return dbl();
+        }
+        return zero();
+    }
+    g2 r;
+    t[3] = t[1].sub(x);             // H = U2-X1
+    t[4] = t[3].square();           // HH = H^2
+    t[5] = t[4].dbl().dbl();        // I = 4*HH
+    t[6] = t[3].mul(t[5]);          // J = H*I
+    t[2] = t[2].sub(y).dbl();       // r = 2*(S2-Y1)
+    t[7] = x.mul(t[5]);             // V = X1*I
+    r.x = t[2].square().sub(t[6]).sub(t[7]).sub(t[7]);      // X3 = r^2-J-2*V
+    r.y = t[2].mul(t[7].sub(r.x)).sub(y.mul(t[6]).dbl());   // Y3 = r*(V-X3)-2*Y1*J
+    r.z = z.add(t[3]).square().sub(t[0]).sub(t[4]);         // Z3 = (Z1+H)^2-Z1Z1-HH
+    return r;
+}
+
+g2 g2::dbl() const
+{
+    // http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#doubling-dbl-2009-l
+    if(isZero())
+    {
+        return *this;
+    }
+    fp2 t[9];
+    g2 r;
+    t[0] = x.square();
+    t[1] = y.square();
+    t[2] = t[1].square();
+    t[1] = x.add(t[1]);
     t[1] = t[1].square();
     t[1] = t[1].sub(t[0]);
     t[1] = t[1].sub(t[2]);
@@ -976,6 +1595,30 @@ g2 g2::dbl() const
     return r;
 }
 
+g2 g2::dblN(const uint64_t n) const
+{
+    // dbl-2009-l in place, without the temporaries and zero checks of n calls to dbl()
+    if(isZero())
+    {
+        return *this;
+    }
+    fp2 t[4];
+    g2 r = *this;
+    for(uint64_t i = 0; i < n; i++)
+    {
+        t[0] = r.x.square();                                    // A = X1^2
+        t[1] = r.y.square();                                    // B = Y1^2
+        t[2] = t[1].square();                                   // C = B^2
+        t[1] = r.x.add(t[1]).square().sub(t[0]).sub(t[2]).dbl(); // D = 2*((X1+B)^2-A-C)
+        t[0] = t[0].dbl().add(t[0]);                            // E = 3*A
+        r.z = r.y.mul(r.z).dbl();                               // Z3 = 2*Y1*Z1
+        t[3] = t[0].square();                                   // F = E^2
+        r.x = t[3].sub(t[1].dbl());                             // X3 = F-2*D
+        r.y = t[0].mul(t[1].sub(r.x)).sub(t[2].dbl().dbl().dbl()); // Y3 = E*(D-X3)-8*C
+    }
+    return r;
+}
+
 g2 g2::neg() const
 {
     g2 r;
@@ -1044,8 +1687,21 @@ g2 g2::frobeniusMap(int64_t power) const
 // MultiExp calculates multi exponentiation. Given pairs of G2 point and scalar values
 // (P_0, e_0), (P_1, e_1), ... (P_n, e_n) calculates r = e_0 * P_0 + e_1 * P_1 + ... + e_n * P_n
 // Length of points and scalars are expected to be equal, otherwise an error is returned.
+// If all scalars are known to be short, 'numBits' limits the number of windows processed.
 // Result is assigned to point at first argument.
-g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers)
+g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits)
+{
+    if(points.size() != powers.size())
+    {
+        throw invalid_argument("point and scalar vectors must have same length!");
+    }
+    // every point is added once per window: normalize them so that those are all mixed additions
+    const vector<g2_affine> bases = g2_affine::fromJacobian(points);
+    return multiExp(bases, powers, numBits);
+}
+
+// Same as above with the points already in affine form
+g2 g2::multiExp(span<const g2_affine> points, vector<array<uint64_t, 4>>& powers, const uint64_t numBits)
 {
     if(points.size() != powers.size())
     {
@@ -1057,7 +1713,6 @@ g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers)
         c = static_cast<uint64_t>(ceil(log10(static_cast<double>(powers.size()))));
     }
     uint64_t bucketSize = (1<<c)-1;
-    uint64_t numBits = 255;
     vector<g2> windows;
     windows.reserve(numBits/c+1);
     vector<g2> bucket;
@@ -1082,7 +1737,7 @@ g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers)
             uint64_t index = s0 & mask;
             if(index != 0)
             {
-                bucket[index-1] = bucket[index-1].add(points[i]);
+                bucket[index-1] = bucket[index-1].addMixed(points[i]);
             }
             scalar::rsh(powers[i], c);
         }
@@ -1098,11 +1753,7 @@ g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers)
     acc = zero();
     for(int64_t i = windows.size() - 1; i >= 0; i--)
     {
-        for(j = 0; j < c; j++)
-        {
-            acc = acc.dbl();
-        }
-        acc = acc.add(windows[i]);
+        acc = acc.dblN(c).add(windows[i]);
     }
     return acc;
 }
@@ -1113,58 +1764,195 @@ g2 g2::multiExp(const vector<g2>& points, vector<array<uint64_t, 4>>& powers)
 // Input byte slice should be a valid field element, otherwise an error is returned.
 g2 g2::mapToCurve(const fp2& e)
 {
-    fp2 u = e;
-    fp2 x, y, z = fp2::one();
-    tie(x, y) = swuMapG2(u);
-    g2 p({x, y, z});
-    p = p.isogenyMap();
+    fp2 xNum, xDen, y;
+    tie(xNum, xDen, y) = swuMapG2(e);
+    g2 p = isogenyMapG2(xNum, xDen, y);
     p = p.clearCofactor();
     return p;
 }
 
-g2 g2::fromMessage(const vector<uint8_t>& msg, const string& dst)
+// Reduces the 256 bytes of expand_message_xmd output to the two fp2 elements of hash_to_field
+static array<fp2, 2> fieldElementsG2(const uint8_t* buf)
 {
-    uint8_t buf[4 * 64];
-    xmd_sh256(buf, 4 * 64, msg.data(), msg.size(), reinterpret_cast<const uint8_t*>(dst.c_str()), dst.length());
-    
+    array<fp2, 2> u;
     array<uint64_t, 8> k = {0};
-    fp2 t = fp2::zero();
-    g2 p;
+    for(uint64_t i = 0; i < 2; i++)
+    {
+        k = scalar::fromBytesBE<8>(span<const uint8_t, 64>(buf + (2*i)*64, buf + (2*i+1)*64));
+        u[i].c0 = fp::modPrime(k);
+        k = scalar::fromBytesBE<8>(span<const uint8_t, 64>(buf + (2*i+1)*64, buf + (2*i+2)*64));
+        u[i].c1 = fp::modPrime(k);
+    }
+    return u;
+}
+
+// hashToField implements hash_to_field of RFC 9380 (section 5.2) for count = 2: expands the message with
+// expand_message_xmd (sha256) and reduces each 64 byte chunk modulo p.
+array<fp2, 2> g2::hashToField(const vector<uint8_t>& msg, const string& dst)
+{
+    return hashToField(msg, hash_to_curve_context(dst));
+}
+
+array<fp2, 2> g2::hashToField(const vector<uint8_t>& msg, const hash_to_curve_context& ctx)
+{
+    uint8_t buf[4 * 64];
+    ctx.expandMessageXmd(buf, 4 * 64, msg.data(), msg.size());
+    return fieldElementsG2(buf);
+}
 
-    k = scalar::fromBytesBE<8>(span<uint8_t, 64>(buf, buf + 64));
-    t.c0 = fp::modPrime(k);
-    k = scalar::fromBytesBE<8>(span<uint8_t, 64>(buf + 64, buf + 2*64));
-    t.c1 = fp::modPrime(k);
+// map_to_curve, iso_map and clear_cofactor of the two hash_to_field elements
+static g2 fieldElementsToG2(const array<fp2, 2>& u)
+{
+    fp2 xNum, xDen, y;
 
-    p = g2::mapToCurve(t);
+    tie(xNum, xDen, y) = g2::swuMapG2(u[0]);
+    g2 q0 = g2::isogenyMapG2(xNum, xDen, y);
+    tie(xNum, xDen, y) = g2::swuMapG2(u[1]);
+    g2 q1 = g2::isogenyMapG2(xNum, xDen, y);
 
-    k = scalar::fromBytesBE<8>(span<uint8_t, 64>(buf + 2*64, buf + 3*64));
-    t.c0 = fp::modPrime(k);
-    k = scalar::fromBytesBE<8>(span<uint8_t, 64>(buf + 3*64, buf + 4*64));
-    t.c1 = fp::modPrime(k);
+    return q0.add(q1).clearCofactor();
+}
 
-    p = p.add(g2::mapToCurve(t));
-    return p;
+// fromMessage implements hash_to_curve of RFC 9380 (section 3) in explicit stages: hash_to_field,
+// map_to_curve (SSWU onto the isogenous curve), iso_map and a single clear_cofactor of the sum.
+g2 g2::fromMessage(const vector<uint8_t>& msg, const string& dst)
+{
+    return fromMessage(msg, hash_to_curve_context(dst));
 }
 
-tuple<fp2, fp2> g2::swuMapG2(const fp2& e)
+g2 g2::fromMessage(const vector<uint8_t>& msg, const hash_to_curve_context& ctx)
 {
-    struct swuParamsForG2
+    return fieldElementsToG2(hashToField(msg, ctx));
+}
+
+// fromMessages hashes a batch of messages to G2 (same result as calling fromMessage for each of them).
+// The messages are expanded together and mapped to the curve on the shared thread pool.
+vector<g2> g2::fromMessages(span<const vector<uint8_t>> msgs, const string& dst)
+{
+    return fromMessages(msgs, hash_to_curve_context(dst));
+}
+
+vector<g2> g2::fromMessages(span<const vector<uint8_t>> msgs, const hash_to_curve_context& ctx)
+{
+    // expand_message_xmd of all messages at once (multi-buffer sha256)
+    vector<uint8_t> expanded(msgs.size() * 4 * 64);
+    ctx.expandMessageXmd(expanded.data(), 4 * 64, msgs);
+    auto map = [&](size_t i)
+    {
+        return fieldElementsToG2(fieldElementsG2(expanded.data() + i * 4 * 64));
+    };
+
+    // a hash to G2 costs far more than handing out a task, but small batches are still not worth waking workers
+    const size_t minChunk = 16;
+    thread_pool& pool = thread_pool::instance();
+    const size_t numChunks = max<size_t>(1, min(pool.concurrency(), msgs.size() / minChunk));
+    vector<g2> res(msgs.size());
+    pool.run(numChunks, [&](size_t t)
+    {
+        for(size_t i = msgs.size() * t / numChunks; i < msgs.size() * (t + 1) / numChunks; i++)
+        {
+            res[i] = map(i);
+        }
+    });
+    return res;
+}
+
+// sqrt_ratio for q = p^2 = 9 mod 16 (RFC 9380, appendix F.2.1.1 with c1 = 3). Returns whether u/v is square
+// and sets y = sqrt(u/v) if it is or y = sqrt(Z * u/v) otherwise. The exponentiation by c3 = (p^2 - 9) / 16
+// is split into c3 = a * p + b, so that x^c3 = frobenius(x)^a * x^b needs only half of the squarings.
+static bool sqrtRatio(fp2& y, const fp2& u, const fp2& v)
+{
+    static const array<uint64_t, 6> c3a = {0xfb9feffffffffaaa, 0x41eabfffeb153fff, 0xf6730d2a0f6b0f62, 0x764774b84f38512b, 0xa4b1ba7b6434bacd, 0x01a0111ea397fe69};
+    static const array<uint64_t, 6> c3b = {0xcfdf4fffffffc555, 0xd5163fff19e9bfff, 0x96f190cea999a938, 0x151203eb676b7ce3, 0x13a3034d4e4406d4, 0x11e0bc510787ee8a};
+    // c6 = Z^((p^2 - 1) / 8), c7 = Z^((p^2 + 7) / 16)
+    static const fp2 c6 = fp2({
+        fp({0x7bcfa7a25aa30fda, 0xdc17dec12a927e7c, 0x2f088dd86b4ebef1, 0xd1ca2087da74d4a7, 0x2da2596696cebc1d, 0x0e2b7eedbbfd87d2}),
+        fp({0x7bcfa7a25aa30fda, 0xdc17dec12a927e7c, 0x2f088dd86b4ebef1, 0xd1ca2087da74d4a7, 0x2da2596696cebc1d, 0x0e2b7eedbbfd87d2}),
+    });
+    static const fp2 c7 = fp2({
+        fp({0x1aab5a8f05eb0ad5, 0x7f978a137f5c75a8, 0x88dddbddb2dcb26e, 0x5f39d438d31d1798, 0x8ffe34a7d8ef2b8e, 0x000fd871abca7e2f}),
+        fp({0xe970a0b7810e8983, 0x8d515f4ef7bdacaa, 0x18b052103a1fcfce, 0x2fc57aed4654434a, 0x0ebb355a46c49672, 0x12c4c8c52d4b5b10}),
+    });
+    fp2 tv1, tv2, tv3, tv4, tv5;
+    tv1 = c6;
+    // tv2 = v^7, tv3 = v^15
+    tv2 = v.square();
+    tv3 = tv2.square();
+    tv2 = tv2.mul(tv3);
+    tv2 = tv2.mul(v);
+    tv3 = tv2.square();
+    tv3 = tv3.mul(v);
+    tv3 = tv3.mul(u);
+    // tv5 = tv3^c3
+    fp2 f = tv3.frobeniusMap(1);
+    fp n = tv3.mul(f).c0;
+    tv5 = fp2::one();
+    for(int64_t i = 380; i >= 0; i--)
+    {
+        tv5 = tv5.square();
+        bool ba = (c3a[i/64] >> (i%64) & 1) == 1;
+        bool bb = (c3b[i/64] >> (i%64) & 1) == 1;
+        if(ba && bb)
+        {
+            tv5 = tv5.mulByFq(n);
+        }
+        else if(ba)
+        {
+            tv5 = tv5.mul(f);
+        }
+        else if(bb)
+        {
+            tv5 = tv5.mul(tv3);
+        }
+    }
+    tv5 = tv5.mul(tv2);
+    tv2 = tv5.mul(v);
+    tv3 = tv5.mul(u);
+    tv4 = tv3.mul(tv2);
+    tv5 = tv4.square().square();
+    bool isQR = tv5.isOne();
+    tv2 = tv3.mul(c7);
+    tv5 = tv4.mul(tv1);
+    if(!isQR)
+    {
+        tv3 = tv2;
+        tv4 = tv5;
+    }
+    for(int64_t k = 3; k >= 2; k--)
+    {
+        tv5 = tv4;
+        for(int64_t j = 0; j < k - 2; j++)
+        {
+            tv5 = tv5.square();
+        }
+        bool e1 = tv5.isOne();
+        tv2 = tv3.mul(tv1);
+        tv1 = tv1.square();
+        tv5 = tv4.mul(tv1);
+        if(!e1)
+        {
+            tv3 = tv2;
+            tv4 = tv5;
+        }
+    }
+    y = tv3;
+    return isQR;
+}
+
+// swuMapG2 implements the simplified SWU map onto the 3-isogenous curve E' (RFC 9380, section 6.6.2 and
+// appendix F.2). It needs no inversion: the result is returned as x = xNum / xDen and y.
+tuple<fp2, fp2, fp2> g2::swuMapG2(const fp2& e)
+{
+    static const struct swuParamsForG2
     {
         fp2 z;
-        fp2 zInv;
         fp2 a;
         fp2 b;
-        fp2 minusBOverA;
     } params = {
         fp2({
             fp({0x87ebfffffff9555c, 0x656fffe5da8ffffa, 0x0fd0749345d33ad2, 0xd951e663066576f4, 0xde291a3d41e980d3, 0x0815664c7dfe040d}),
             fp({0x43f5fffffffcaaae, 0x32b7fff2ed47fffd, 0x07e83a49a2e99d69, 0xeca8f3318332bb7a, 0xef148d1ea0f4c069, 0x040ab3263eff0206}),
         }),
-        fp2({
-            fp({0xacd0000000011110, 0x9dd9999dc88ccccd, 0xb5ca2ac9b76352bf, 0xf1b574bcf4bc90ce, 0x42dab41f28a77081, 0x132fc6ac14cd1e12}),
-            fp({0xe396ffffffff2223, 0x4fbf332fcd0d9998, 0x0c4bbd3c1aff4cc4, 0x6b9c91267926ca58, 0x29ae4da6aef7f496, 0x10692e942f195791}),
-        }),
         fp2({
             fp({0, 0, 0, 0, 0, 0}),
             fp({0xe53a000003135242, 0x01080c0fdef80285, 0xe7889edbe340f6bd, 0x0b51375126310601, 0x02d6985717c744ab, 0x1220b4e979ea5467}),
@@ -1173,163 +1961,49 @@ tuple<fp2, fp2> g2::swuMapG2(const fp2& e)
             fp({0x22ea00000cf89db2, 0x6ec832df71380aa4, 0x6e1b94403db5a66e, 0x75bf3c53a79473ba, 0x3dd3a569412c0a34, 0x125cdb5e74dc4fd1}),
             fp({0x22ea00000cf89db2, 0x6ec832df71380aa4, 0x6e1b94403db5a66e, 0x75bf3c53a79473ba, 0x3dd3a569412c0a34, 0x125cdb5e74dc4fd1}),
         }),
-        fp2({
-            fp({0x903c555555474fb3, 0x5f98cc95ce451105, 0x9f8e582eefe0fade, 0xc68946b6aebbd062, 0x467a4ad10ee6de53, 0x0e7146f483e23a05}),
-            fp({0x29c2aaaaaab85af8, 0xbf133368e30eeefa, 0xc7a27a7206cffb45, 0x9dee04ce44c9425c, 0x04a15ce53464ce83, 0x0b8fcaf5b59dac95}),
-        }),
     };
-    fp2 tv[4];
+    fp2 tv[6];
     fp2 u = e;
     tv[0] = u.square();
-    tv[0] = tv[0].mul(params.z);
+    tv[0] = params.z.mul(tv[0]);
     tv[1] = tv[0].square();
-    fp2 x1;
-    x1 = tv[0].add(tv[1]);
-    x1 = x1.inverse();
-    bool e1 = x1.isZero();
-    x1 = x1.add(fp2::one());
-    if(e1)
-    {
-        x1 = params.zInv;
-    }
-    x1 = x1.mul(params.minusBOverA);
-    fp2 gx1;
-    gx1 = x1.square();
-    gx1 = gx1.add(params.a);
-    gx1 = gx1.mul(x1);
-    gx1 = gx1.add(params.b);
-    fp2 x2;
-    x2 = tv[0].mul(x1);
-    tv[1] = tv[0].mul(tv[1]);
-    fp2 gx2;
-    gx2 = gx1.mul(tv[1]);
-    bool e2 = !gx1.isQuadraticNonResidue();
-    fp2 x, y2;
-    if(e2)
-    {
-        x = x1;
-        y2 = gx1;
+    tv[1] = tv[1].add(tv[0]);
+    tv[2] = tv[1].add(fp2::one());
+    tv[2] = params.b.mul(tv[2]);
+    // x denominator
+    tv[3] = tv[1].isZero() ? params.z : tv[1].neg();
+    tv[3] = params.a.mul(tv[3]);
+    // g(x1) = tv[1] / tv[5]
+    tv[1] = tv[2].square();
+    tv[5] = tv[3].square();
+    tv[4] = params.a.mul(tv[5]);
+    tv[1] = tv[1].add(tv[4]);
+    tv[1] = tv[1].mul(tv[2]);
+    tv[5] = tv[5].mul(tv[3]);
+    tv[4] = params.b.mul(tv[5]);
+    tv[1] = tv[1].add(tv[4]);
+    fp2 x, y, y1;
+    x = tv[0].mul(tv[2]);
+    bool isGx1Square = sqrtRatio(y1, tv[1], tv[5]);
+    y = tv[0].mul(u);
+    y = y.mul(y1);
+    if(isGx1Square)
+    {
+        x = tv[2];
+        y = y1;
     }
-    else
-    {
-        x = x2;
-        y2 = gx2;
-    }
-    fp2 y;
-    y2.sqrt(y);
     if(y.sign() != u.sign())
     {
         y = y.neg();
     }
-    return {x, y};
+    return {x, tv[3], y};
 }
-/*
-void g2::isogenyMapG2(fp2& x, fp2& y)
+
+// isogenyMapG2 evaluates the 3-isogeny from E' to E (RFC 9380, appendix E.3) at x = xNum / xDen. The rational maps
+// are homogenized in xNum and xDen, so the result is returned in jacobian coordinates without any inversion.
+g2 g2::isogenyMapG2(const fp2& xNum, const fp2& xDen, const fp2& y)
 {
-    // https://tools.ietf.org/html/draft-irtf-cfrg-hash-to-curve-06#appendix-C.2
-    fp2 isogenyConstantsG2[4][4] = {
-        {
-            fp2({
-                fp({0x47f671c71ce05e62, 0x06dd57071206393e, 0x7c80cd2af3fd71a2, 0x048103ea9e6cd062, 0xc54516acc8d037f6, 0x13808f550920ea41}),
-                fp({0x47f671c71ce05e62, 0x06dd57071206393e, 0x7c80cd2af3fd71a2, 0x048103ea9e6cd062, 0xc54516acc8d037f6, 0x13808f550920ea41}),
-            }),
-            fp2({
-                fp({0, 0, 0, 0, 0, 0}),
-                fp({0x5fe55555554c71d0, 0x873fffdd236aaaa3, 0x6a6b4619b26ef918, 0x21c2888408874945, 0x2836cda7028cabc5, 0x0ac73310a7fd5abd}),
-            }),
-            fp2({
-                fp({0x0a0c5555555971c3, 0xdb0c00101f9eaaae, 0xb1fb2f941d797997, 0xd3960742ef416e1c, 0xb70040e2c20556f4, 0x149d7861e581393b}),
-                fp({0xaff2aaaaaaa638e8, 0x439fffee91b55551, 0xb535a30cd9377c8c, 0x90e144420443a4a2, 0x941b66d3814655e2, 0x0563998853fead5e}),
-            }),
-            fp2({
-                fp({0x40aac71c71c725ed, 0x190955557a84e38e, 0xd817050a8f41abc3, 0xd86485d4c87f6fb1, 0x696eb479f885d059, 0x198e1a74328002d2}),
-                fp({0, 0, 0, 0, 0, 0}),
-            }),
-        },
-        {
-            fp2({
-                fp({0, 0, 0, 0, 0, 0}),
-                fp({0x1f3affffff13ab97, 0xf25bfc611da3ff3e, 0xca3757cb3819b208, 0x3e6427366f8cec18, 0x03977bc86095b089, 0x04f69db13f39a952}),
-            }),
-            fp2({
-                fp({0x447600000027552e, 0xdcb8009a43480020, 0x6f7ee9ce4a6e8b59, 0xb10330b7c0a95bc6, 0x6140b1fcfb1e54b7, 0x0381be097f0bb4e1}),
-                fp({0x7588ffffffd8557d, 0x41f3ff646e0bffdf, 0xf7b1e8d2ac426aca, 0xb3741acd32dbb6f8, 0xe9daf5b9482d581f, 0x167f53e0ba7431b8}),
-            }),
-            fp2({
-                fp({0x760900000002fffd, 0xebf4000bc40c0002, 0x5f48985753c758ba, 0x77ce585370525745, 0x5c071a97a256ec6d, 0x15f65ec3fa80e493}),
-                fp({0, 0, 0, 0, 0, 0}),
-            }),
-            fp2({
-                fp({0, 0, 0, 0, 0, 0}),
-                fp({0, 0, 0, 0, 0, 0}),
-            }),
-        },
-        {
-            fp2({
-                fp({0x96d8f684bdfc77be, 0xb530e4f43b66d0e2, 0x184a88ff379652fd, 0x57cb23ecfae804e1, 0x0fd2e39eada3eba9, 0x08c8055e31c5d5c3}),
-                fp({0x96d8f684bdfc77be, 0xb530e4f43b66d0e2, 0x184a88ff379652fd, 0x57cb23ecfae804e1, 0x0fd2e39eada3eba9, 0x08c8055e31c5d5c3}),
-            }),
-            fp2({
-                fp({0, 0, 0, 0, 0, 0}),
-                fp({0xbf0a71c71c91b406, 0x4d6d55d28b7638fd, 0x9d82f98e5f205aee, 0xa27aa27b1d1a18d5, 0x02c3b2b2d2938e86, 0x0c7d13420b09807f}),
-            }),
-            fp2({
-                fp({0xd7f9555555531c74, 0x21cffff748daaaa8, 0x5a9ad1866c9bbe46, 0x4870a2210221d251, 0x4a0db369c0a32af1, 0x02b1ccc429ff56af}),
-                fp({0xe205aaaaaaac8e37, 0xfcdc000768795556, 0x0c96011a8a1537dd, 0x1c06a963f163406e, 0x010df44c82a881e6, 0x174f45260f808feb}),
-            }),
-            fp2({
-                fp({0xa470bda12f67f35c, 0xc0fe38e23327b425, 0xc9d3d0f2c6f0678d, 0x1c55c9935b5a982e, 0x27f6c0e2f0746764, 0x117c5e6e28aa9054}),
-                fp({0, 0, 0, 0, 0, 0}),
-            }),
-        },
-        {
-            fp2({
-                fp({0x0162fffffa765adf, 0x8f7bea480083fb75, 0x561b3c2259e93611, 0x11e19fc1a9c875d5, 0xca713efc00367660, 0x03c6a03d41da1151}),
-                fp({0x0162fffffa765adf, 0x8f7bea480083fb75, 0x561b3c2259e93611, 0x11e19fc1a9c875d5, 0xca713efc00367660, 0x03c6a03d41da1151}),
-            }),
-            fp2({
-                fp({0, 0, 0, 0, 0, 0}),
-                fp({0x5db0fffffd3b02c5, 0xd713f52358ebfdba, 0x5ea60761a84d161a, 0xbb2c75a34ea6c44a, 0x0ac6735921c1119b, 0x0ee3d913bdacfbf6}),
-            }),
-            fp2({
-                fp({0x66b10000003affc5, 0xcb1400e764ec0030, 0xa73e5eb56fa5d106, 0x8984c913a0fe09a9, 0x11e10afb78ad7f13, 0x05429d0e3e918f52}),
-                fp({0x534dffffffc4aae6, 0x5397ff174c67ffcf, 0xbff273eb870b251d, 0xdaf2827152870915, 0x393a9cbaca9e2dc3, 0x14be74dbfaee5748}),
-            }),
-            fp2({
-                fp({0x760900000002fffd, 0xebf4000bc40c0002, 0x5f48985753c758ba, 0x77ce585370525745, 0x5c071a97a256ec6d, 0x15f65ec3fa80e493}),
-                fp({0, 0, 0, 0, 0, 0}),
-            }),
-        }
-    };
-    fp2 (*params)[4] = isogenyConstantsG2;
-    uint64_t degree = 3;
-    fp2 xNum = params[0][degree];
-    fp2 xDen = params[1][degree];
-    fp2 yNum = params[2][degree];
-    fp2 yDen = params[3][degree];
-    for(int64_t i = degree - 1; i >= 0; i--)
-    {
-        xNum = xNum.mul(x);
-        xDen = xDen.mul(x);
-        yNum = yNum.mul(x);
-        yDen = yDen.mul(x);
-        xNum = xNum.add(params[0][i]);
-        xDen = xDen.add(params[1][i]);
-        yNum = yNum.add(params[2][i]);
-        yDen = yDen.add(params[3][i]);
-    }
-    xDen = xDen.inverse();
-    yDen = yDen.inverse();
-    xNum = xNum.mul(xDen);
-    yNum = yNum.mul(yDen);
-    yNum = yNum.mul(y);
-    x = xNum;
-    y = yNum;
-}
-*/
-g2 g2::isogenyMap() const
-{
-    fp2 isogenyConstantsG2[4][4] = {
+    static const fp2 isogenyConstantsG2[4][4] = {
         {
             fp2({
                 fp({0x47f671c71ce05e62, 0x06dd57071206393e, 0x7c80cd2af3fd71a2, 0x048103ea9e6cd062, 0xc54516acc8d037f6, 0x13808f550920ea41}),
@@ -1403,47 +2077,38 @@ g2 g2::isogenyMap() const
             }),
         }
     };
-    
-    fp2 t0, t1, t2, t3;
-    g2 q;
-    fp2 (*params)[4] = isogenyConstantsG2;
-
-    t0 = params[0][3];
-    for(int i = 3; i > 0; --i)
-    {
-        t0 = t0.mul(x);
-        t0 = t0.add(params[0][i - 1]);
-    }
-    t1 = params[2][3];
-    for(int i = 3; i > 0; --i)
+    const fp2 (*params)[4] = isogenyConstantsG2;
+    const int64_t degree = 3;
+    fp2 xDenPow[degree + 1];
+    xDenPow[0] = fp2::one();
+    for(int64_t i = 1; i <= degree; i++)
     {
-        t1 = t1.mul(x);
-        t1 = t1.add(params[2][i - 1]);
+        xDenPow[i] = xDenPow[i - 1].mul(xDen);
     }
-    t2 = params[3][3];
-    for(int i = 3; i > 0; --i)
+    // n[0] = x numerator, n[1] = x denominator, n[2] = y numerator, n[3] = y denominator
+    fp2 n[4];
+    for(int64_t k = 0; k < 4; k++)
     {
-        t2 = t2.mul(x);
-        t2 = t2.add(params[3][i - 1]);
-    }
-    t3 = params[1][2];
-    for(int i = 2; i > 0; --i)
-    {
-        t3 = t3.mul(x);
-        t3 = t3.add(params[1][i - 1]);
+        n[k] = params[k][degree];
+        for(int64_t i = degree - 1; i >= 0; i--)
+        {
+            n[k] = n[k].mul(xNum);
+            if(!params[k][i].isZero())
+            {
+                n[k] = n[k].add(params[k][i].mul(xDenPow[degree - i]));
+            }
+        }
     }
-
-    // Y = Ny * Dx * Z^2.
-    q.y = y.mul(t1);
-    q.y = q.y.mul(t3);
-    // Z = Dx * Dy, t1 = Z^2.
-    q.z = t2.mul(t3);
-    t1 = q.z.square();
-    q.y = q.y.mul(t1);
-    // X = Nx * Dy * Z.
-    q.x = t0.mul(t2);
+    g2 q;
+    // Z = Dx * Dy
+    q.z = n[1].mul(n[3]);
+    // X = Nx * Dy * Z
+    q.x = n[0].mul(n[3]);
     q.x = q.x.mul(q.z);
-
+    // Y = y * Ny * Dx * Z^2
+    q.y = y.mul(n[2]);
+    q.y = q.y.mul(n[1]);
+    q.y = q.y.mul(q.z.square());
     return q;
 }
 
@@ -1464,4 +2129,243 @@ const g2 g2::BASE = g2({
 
 const array<uint64_t, 1> g2::cofactorEFF = {0xd201000000010000};
 
+g2_affine::g2_affine() : x(fp2::zero()), y(fp2::zero()), infinity(true)
+{
+}
+
+g2_affine::g2_affine(const fp2& x, const fp2& y) : x(x), y(y), infinity(false)
+{
+}
+
+g2_affine::g2_affine(const g2& e) : infinity(e.isZero())
+{
+    if(infinity)
+    {
+        x = fp2::zero();
+        y = fp2::zero();
+        return;
+    }
+    const g2 a = e.affine();
+    x = a.x;
+    y = a.y;
+}
+
+vector<g2_affine> g2_affine::fromJacobian(span<const g2> points)
+{
+    vector<g2> a(points.begin(), points.end());
+    g2::batchAffine(a);
+    vector<g2_affine> r;
+    r.reserve(a.size());
+    for(const g2& p : a)
+    {
+        r.push_back(p.isZero() ? zero() : g2_affine(p.x, p.y));
+    }
+    return r;
+}
+
+g2_affine g2_affine::fromCompressedBytesBE(const span<const uint8_t, 96> in)
+{
+    return g2_affine(g2::fromCompressedBytesBE(in));
+}
+
+array<uint8_t, 96> g2_affine::toCompressedBytesBE() const
+{
+    return g2(*this).toCompressedBytesBE();
+}
+
+g2_affine g2_affine::zero()
+{
+    return g2_affine();
+}
+
+bool g2_affine::isZero() const
+{
+    return infinity;
+}
+
+bool g2_affine::equal(const g2_affine& e) const
+{
+    if(infinity || e.infinity)
+    {
+        return infinity == e.infinity;
+    }
+    return x.equal(e.x) && y.equal(e.y);
+}
+
+bool g2_affine::inCorrectSubgroup() const
+{
+    return g2(*this).inCorrectSubgroup();
+}
+
+bool g2_affine::isOnCurve() const
+{
+    return g2(*this).isOnCurve();
+}
+
+g2_affine g2_affine::neg() const
+{
+    return infinity ? *this : g2_affine(x, y.neg());
+}
+
+// 3 * b * x = 12 * (1 + u) * x
+static fp2 mulBy3b(const fp2& x)
+{
+    const fp2 t = x.mulByB();
+    return t.dbl().add(t);
+}
+
+g2_projective::g2_projective() : x(fp2::zero()), y(fp2::one()), z(fp2::zero())
+{
+}
+
+g2_projective::g2_projective(const g2& e)
+{
+    // (x, y, z) -> (x*z, y, z^3)
+    if(e.isZero())
+    {
+        *this = zero();
+        return;
+    }
+    x = e.x.mul(e.z);
+    y = e.y;
+    z = e.z.square().mul(e.z);
+}
+
+g2_projective::g2_projective(const g2_affine& e) : x(e.x), y(e.y), z(fp2::one())
+{
+    if(e.infinity)
+    {
+        *this = zero();
+    }
+}
+
+g2 g2_projective::affine() const
+{
+    if(isZero())
+    {
+        return g2::zero();
+    }
+    const fp2 t = z.inverseConstTime();
+    return g2({x.mul(t), y.mul(t), fp2::one()});
+}
+
+g2_projective g2_projective::zero()
+{
+    return g2_projective();
+}
+
+bool g2_projective::isZero() const
+{
+    return z.isZero();
+}
+
+bool g2_projective::equal(const g2_projective& e) const
+{
+    // X1*Z2 == X2*Z1 and Y1*Z2 == Y2*Z1, which also covers the point at infinity
+    return x.mul(e.z).equal(e.x.mul(z)) && y.mul(e.z).equal(e.y.mul(z));
+}
+
+g2_projective g2_projective::add(const g2_projective& e) const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 7
+    fp2 t[5];
+    g2_projective r;
+    t[0] = x.mul(e.x);                                  // t0 = X1*X2
+    t[1] = y.mul(e.y);                                  // t1 = Y1*Y2
+    t[2] = z.mul(e.z);                                  // t2 = Z1*Z2
+    t[3] = x.add(y).mul(e.x.add(e.y)).sub(t[0].add(t[1]));  // t3 = X1*Y2+X2*Y1
+    t[4] = y.add(z).mul(e.y.add(e.z)).sub(t[1].add(t[2]));  // t4 = Y1*Z2+Y2*Z1
+    r.y = x.add(z).mul(e.x.add(e.z)).sub(t[0].add(t[2]));   // Y3 = X1*Z2+X2*Z1
+    t[0] = t[0].dbl().add(t[0]);                        // t0 = 3*X1*X2
+    t[2] = mulBy3b(t[2]);
+    r.z = t[1].add(t[2]);
+    t[1] = t[1].sub(t[2]);
+    r.y = mulBy3b(r.y);
+    r.x = t[3].mul(t[1]).sub(t[4].mul(r.y));           // X3 = t3*t1-t4*Y3
+    r.y = t[1].mul(r.z).add(r.y.mul(t[0]));            // Y3 = t1*Z3+t0*Y3
+    r.z = r.z.mul(t[4]).add(t[0].mul(t[3]));           // Z3 = t4*Z3+t0*t3
+    return r;
+}
+
+g2_projective g2_projective::addMixed(const g2_affine& e) const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 8; the infinity flag is applied with a select at the end
+    fp2 t[5];
+    g2_projective r;
+    t[0] = x.mul(e.x);                                  // t0 = X1*X2
+    t[1] = y.mul(e.y);                                  // t1 = Y1*Y2
+    t[3] = e.x.add(e.y).mul(x.add(y)).sub(t[0].add(t[1]));  // t3 = X1*Y2+X2*Y1
+    t[4] = e.y.mul(z).add(y);                           // t4 = Y2*Z1+Y1
+    r.y = e.x.mul(z).add(x);                            // Y3 = X2*Z1+X1
+    t[0] = t[0].dbl().add(t[0]);                        // t0 = 3*X1*X2
+    t[2] = mulBy3b(z);
+    r.z = t[1].add(t[2]);
+    t[1] = t[1].sub(t[2]);
+    r.y = mulBy3b(r.y);
+    r.x = t[3].mul(t[1]).sub(t[4].mul(r.y));           // X3 = t3*t1-t4*Y3
+    r.y = t[1].mul(r.z).add(r.y.mul(t[0]));            // Y3 = t1*Z3+t0*Y3
+    r.z = r.z.mul(t[4]).add(t[0].mul(t[3]));           // Z3 = t4*Z3+t0*t3
+    return select(e.infinity, *this, r);
+}
+
+g2_projective g2_projective::dbl() const
+{
+    // https://eprint.iacr.org/2015/1060, algorithm 9
+    fp2 t[3];
+    g2_projective r;
+    t[0] = y.square();                                  // t0 = Y^2
+    r.z = t[0].dbl().dbl().dbl();                       // Z3 = 8*Y^2
+    t[1] = y.mul(z);                                    // t1 = Y*Z
+    t[2] = mulBy3b(z.square());                         // t2 = 3*b*Z^2
+    r.x = t[2].mul(r.z);
+    r.y = t[0].add(t[2]);
+    r.z = t[1].mul(r.z);                                // Z3 = 8*Y^3*Z
+    t[0] = t[0].sub(t[2].dbl().add(t[2]));              // t0 = Y^2-9*b*Z^2
+    r.y = r.x.add(t[0].mul(r.y));                       // Y3 = t0*(Y^2+3*b*Z^2)+24*b*Y^2*Z^2
+    r.x = t[0].mul(x.mul(y)).dbl();                     // X3 = 2*t0*X*Y
+    return r;
+}
+
+g2_projective g2_projective::neg() const
+{
+    g2_projective r = *this;
+    r.y = y.neg();
+    return r;
+}
+
+g2_projective g2_projective::select(const bool c, const g2_projective& a, const g2_projective& b)
+{
+    const uint64_t mask = 0 - static_cast<uint64_t>(c);
+    g2_projective r;
+    cselect(r.x, a.x, b.x, mask);
+    cselect(r.y, a.y, b.y, mask);
+    cselect(r.z, a.z, b.z, mask);
+    return r;
+}
+
+g2_projective g2_projective::mulScalar(const array<uint64_t, 4>& s) const
+{
+    // fixed 4 bit windows: the multiple for each window is read from the table with a full scan of selects,
+    // so neither the memory accesses nor the sequence of additions depend on s
+    array<g2_projective, 16> table;
+    table[1] = *this;
+    for(size_t j = 2; j < 16; j++)
+    {
+        table[j] = table[j-1].add(*this);
+    }
+    g2_projective q = zero();
+    for(int64_t w = 63; w >= 0; w--)
+    {
+        q = q.dbl().dbl().dbl().dbl();
+        const uint64_t bits = (s[w/16] >> ((w%16)*4)) & 0xf;
+        g2_projective t = zero();
+        for(uint64_t j = 1; j < 16; j++)
+        {
+            t = select(j == bits, table[j], t);
+        }
+        q = q.add(t);
+    }
+    return q;
+}
+
 } // namespace bls12_381
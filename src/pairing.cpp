@@ -89,17 +89,132 @@ void pairing::preCompute(array<array<fp2, 3>, 68>& ellCoeffs, g2& twistPoint)
     }
 }
 
-fp12 pairing::millerLoop(vector<tuple<g1, g2>>& pairs)
+// Compact form of the line coefficients: every line is scaled by the inverse of its third
+// coefficient (a factor in fp2 which is wiped out by the final exponentiation) so that only
+// two fp2 elements per line need to be stored. All 68 inversions are batched into one.
+void pairing::preCompute(array<array<fp2, 2>, 68>& ellCoeffs, g2& twistPoint)
 {
+    if(twistPoint.isZero())
+    {
+        return;
+    }
+    array<array<fp2, 3>, 68> full;
+    preCompute(full, twistPoint);
+    array<fp2, 68> acc;
+    fp2 t = fp2::one();
+    for(uint64_t k = 0; k < 68; k++)
+    {
+        acc[k] = t;
+        t.mulAssign(full[k][2]);
+    }
+    t = t.inverse();
+    fp2 inv;
+    for(int64_t k = 68 - 1; k >= 0; k--)
+    {
+        inv = t.mul(acc[k]);
+        t.mulAssign(full[k][2]);
+        ellCoeffs[k][0] = full[k][0].mul(inv);
+        ellCoeffs[k][1] = full[k][1].mul(inv);
+    }
+}
+
+// Skips the pairs containing the point at infinity, brings the remaining points to affine form with one
+// inversion per group (nothing to do for g1_affine and g2_affine), precomputes the lines and runs the Miller loop
+template<typename P, typename Q>
+static fp12 millerLoopPairs(span<const tuple<P, Q>> pairs)
+{
+    vector<g1> p;
+    p.reserve(pairs.size());
+    vector<g2> q;
+    q.reserve(pairs.size());
+    for(const tuple<P, Q>& pair : pairs)
+    {
+        if(get<P>(pair).isZero() || get<Q>(pair).isZero())
+        {
+            continue;
+        }
+        p.push_back(g1(get<P>(pair)));
+        q.push_back(g2(get<Q>(pair)));
+    }
+    g1::batchAffine(p);
+    g2::batchAffine(q);
     vector<array<array<fp2, 3>, 68>> ellCoeffs;
-    //ellCoeffs.reserve(pairs.size());
-    ellCoeffs.resize(pairs.size());
-    for(uint64_t i = 0; i < pairs.size(); i++)
+    ellCoeffs.resize(q.size());
+    vector<const array<array<fp2, 3>, 68>*> c;
+    c.reserve(q.size());
+    for(uint64_t i = 0; i < q.size(); i++)
     {
-        preCompute(ellCoeffs[i], get<g2>(pairs[i]));
+        pairing::preCompute(ellCoeffs[i], q[i]);
+        c.push_back(&ellCoeffs[i]);
     }
-    fp2 t[10];
+    return pairing::millerLoop(p, c);
+}
+
+// Miller loop over pairs of G1 and G2 points in Jacobian or affine form. Instead of normalizing
+// every pair on its own, all points are brought to affine form together with one inversion per
+// group. Pairs containing the point at infinity are skipped.
+fp12 pairing::millerLoop(span<const tuple<g1, g2>> pairs)
+{
+    return millerLoopPairs(pairs);
+}
+
+// Same as above for points that are already affine
+fp12 pairing::millerLoop(span<const tuple<g1_affine, g2_affine>> pairs)
+{
+    return millerLoopPairs(pairs);
+}
+
+// Miller loop over affine G1 points and the precomputed line coefficients of their G2 partners.
+// All line evaluations that are multiplied into the accumulator between two squarings (the
+// doubling lines of all pairs and, if the bit is set, their addition lines) are fused pairwise
+// with the cheap sparse-by-sparse product before being multiplied into the accumulator.
+fp12 pairing::millerLoop(span<const g1> p, span<const array<array<fp2, 3>, 68>* const> ellCoeffs)
+{
+    return millerLoop(p, ellCoeffs, span<const g1>(), span<const array<array<fp2, 2>, 68>* const>());
+}
+
+// Miller loop over affine G1 points and compact line coefficients. The third coefficient of
+// each line is implicitly one, so the G1 y coordinate enters the sparse product unscaled.
+// The result differs from the one of the full coefficients by a factor in fp2 only and
+// therefore agrees after the final exponentiation.
+fp12 pairing::millerLoop(span<const g1> p, span<const array<array<fp2, 2>, 68>* const> ellCoeffs)
+{
+    return millerLoop(span<const g1>(), span<const array<array<fp2, 3>, 68>* const>(), p, ellCoeffs);
+}
+
+// Miller loop over pairs with full line coefficients (p, ellCoeffs) and pairs with compact ones
+// (pCompact, compactCoeffs) at once, so that both forms share the squarings of the accumulator.
+// The lines of each form are fused pairwise among themselves.
+fp12 pairing::millerLoop(
+    span<const g1> p,
+    span<const array<array<fp2, 3>, 68>* const> ellCoeffs,
+    span<const g1> pCompact,
+    span<const array<array<fp2, 2>, 68>* const> compactCoeffs
+)
+{
     fp12 f = fp12::one();
+    if(p.size() + pCompact.size() == 0)
+    {
+        return f;
+    }
+    // line evaluations in sparse 014 form: (e0, e1, e4), and (e0, e1) with e4 = y for compact lines
+    vector<array<fp2, 3>> lines;
+    lines.reserve(2 * p.size());
+    vector<tuple<fp2, fp2, const fp*>> compactLines;
+    compactLines.reserve(2 * pCompact.size());
+    auto evaluate = [&](int64_t k)
+    {
+        for(uint64_t j = 0; j < p.size(); j++)
+        {
+            const array<fp2, 3>& c = (*ellCoeffs[j])[k];
+            lines.push_back({c[0], c[1].mulByFq(p[j].x), c[2].mulByFq(p[j].y)});
+        }
+        for(uint64_t j = 0; j < pCompact.size(); j++)
+        {
+            const array<fp2, 2>& c = (*compactCoeffs[j])[k];
+            compactLines.push_back({c[0], c[1].mulByFq(pCompact[j].x), &pCompact[j].y});
+        }
+    };
     int64_t k = 0;
     for(int64_t i = 64 - 2; i >= 0; i--)
     {
@@ -107,41 +222,65 @@ fp12 pairing::millerLoop(vector<tuple<g1, g2>>& pairs)
         {
             f = f.square();
         }
-        for(uint64_t j = 0; j <= pairs.size()-1; j++)
-        {
-            t[0] = ellCoeffs[j][k][2].mulByFq(get<g1>(pairs[j]).y);
-            t[1] = ellCoeffs[j][k][1].mulByFq(get<g1>(pairs[j]).x);
-            f.mulBy014Assign(ellCoeffs[j][k][0], t[1], t[0]);
-        }
+        lines.clear();
+        compactLines.clear();
+        evaluate(k);
         if(((g2::cofactorEFF[0] >> i) & 1) == 1)
         {
             k++;
-            for(uint64_t j = 0; j <= pairs.size()-1; j++)
-            {
-                t[0] = ellCoeffs[j][k][2].mulByFq(get<g1>(pairs[j]).y);
-                t[1] = ellCoeffs[j][k][1].mulByFq(get<g1>(pairs[j]).x);
-                f.mulBy014Assign(ellCoeffs[j][k][0], t[1], t[0]);
-            }
+            evaluate(k);
         }
         k++;
+        uint64_t j = 0;
+        for(; j + 1 < lines.size(); j += 2)
+        {
+            f.mulBy01245Assign(fp12::mul014By014(
+                lines[j][0], lines[j][1], lines[j][2],
+                lines[j+1][0], lines[j+1][1], lines[j+1][2]
+            ));
+        }
+        if(j < lines.size())
+        {
+            f.mulBy014Assign(lines[j][0], lines[j][1], lines[j][2]);
+        }
+        j = 0;
+        for(; j + 1 < compactLines.size(); j += 2)
+        {
+            f.mulBy01245Assign(fp12::mul014By014(
+                get<0>(compactLines[j]), get<1>(compactLines[j]), *get<2>(compactLines[j]),
+                get<0>(compactLines[j+1]), get<1>(compactLines[j+1]), *get<2>(compactLines[j+1])
+            ));
+        }
+        if(j < compactLines.size())
+        {
+            f.mulBy014Assign(get<0>(compactLines[j]), get<1>(compactLines[j]), *get<2>(compactLines[j]));
+        }
     }
     f = f.conjugate();
     return f;
 }
 
-void pairing::finalExp(fp12& f)
+// Easy part of the final exponentiation: f^((p^6 - 1)(p^2 + 1))
+static fp12 finalExpEasy(const fp12& f)
 {
-    fp12 t[9];
-    // easy part
+    fp12 t[3];
     t[0] = f.frobeniusMap(6);
     t[1] = f.inverse();
     t[2] = t[0].mul(t[1]);
     t[1] = t[2];
     t[2].frobeniusMapAssign(2);
     t[2].mulAssign(t[1]);
+    return t[2];
+}
+
+// Hard part of the final exponentiation of the easy part's result m. The result is returned
+// as the two factors a and b of its last multiplication, so that finalExpIsOne can compare them.
+static void finalExpHard(const fp12& m, fp12& a, fp12& b)
+{
+    fp12 t[9];
+    t[2] = m;
     t[1] = t[2].cyclotomicSquare();
     t[1] = t[1].conjugate();
-    // hard part
     //e.exp(&t[3], &t[2]);
     t[3] = t[2].cyclotomicExp(g2::cofactorEFF);
     t[3] = t[3].conjugate();
@@ -172,7 +311,32 @@ void pairing::finalExp(fp12& f)
     t[3].frobeniusMapAssign(2);
     t[3].mulAssign(t[1]);
     t[3].mulAssign(t[6]);
-    f = t[3].mul(t[4]);
+    a = t[3];
+    b = t[4];
+}
+
+void pairing::finalExp(fp12& f)
+{
+    fp12 a, b;
+    finalExpHard(finalExpEasy(f), a, b);
+    f = a.mul(b);
+}
+
+// Decides whether f^((p^12 - 1) / r) == 1 without computing the full final exponentiation.
+// The easy part is checked first: if it already yields one we are done. For the hard part
+// the last multiplication of finalExp is replaced by an equality test, using that the
+// inverse of an element of the cyclotomic subgroup is its conjugate.
+bool pairing::finalExpIsOne(const fp12& f)
+{
+    const fp12 m = finalExpEasy(f);
+    if(m.isOne())
+    {
+        return true;
+    }
+    fp12 a, b;
+    finalExpHard(m, a, b);
+    // a * b == 1  <=>  a == b^-1
+    return a.equal(b.conjugate());
 }
 
 fp12 pairing::calculate(vector<tuple<g1, g2>>& pairs)
@@ -187,14 +351,100 @@ fp12 pairing::calculate(vector<tuple<g1, g2>>& pairs)
     return f;
 }
 
+// Checks whether the product of the pairings of all given pairs equals one. Pairs
+// containing the point at infinity are skipped. Points may be in Jacobian form.
+bool pairing::check(span<const tuple<g1, g2>> pairs)
+{
+    return finalExpIsOne(millerLoop(pairs));
+}
+
+bool pairing::check(span<const tuple<g1_affine, g2_affine>> pairs)
+{
+    return finalExpIsOne(millerLoop(pairs));
+}
+
+// Same as above but with the line coefficients of the G2 points already precomputed
+bool pairing::check(span<const tuple<g1, array<array<fp2, 3>, 68>>> pairs)
+{
+    vector<const array<array<fp2, 3>, 68>*> c;
+    c.reserve(pairs.size());
+    vector<g1> p;
+    p.reserve(pairs.size());
+    for(const tuple<g1, array<array<fp2, 3>, 68>>& pair : pairs)
+    {
+        // preCompute leaves the coefficients of the point at infinity zeroed
+        if(get<g1>(pair).isZero() || get<1>(pair)[0][2].isZero())
+        {
+            continue;
+        }
+        c.push_back(&get<1>(pair));
+        p.push_back(get<g1>(pair));
+    }
+    if(p.size() == 0)
+    {
+        return true;
+    }
+    g1::batchAffine(p);
+    return finalExpIsOne(millerLoop(p, c));
+}
+
+// Same as above but with the line coefficients of the G2 points precomputed in compact form
+bool pairing::check(span<const tuple<g1, array<array<fp2, 2>, 68>>> pairs)
+{
+    vector<const array<array<fp2, 2>, 68>*> c;
+    c.reserve(pairs.size());
+    vector<g1> p;
+    p.reserve(pairs.size());
+    for(const tuple<g1, array<array<fp2, 2>, 68>>& pair : pairs)
+    {
+        // preCompute leaves the coefficients of the point at infinity zeroed
+        if(get<g1>(pair).isZero() || get<1>(pair)[0][1].isZero())
+        {
+            continue;
+        }
+        c.push_back(&get<1>(pair));
+        p.push_back(get<g1>(pair));
+    }
+    if(p.size() == 0)
+    {
+        return true;
+    }
+    g1::batchAffine(p);
+    return finalExpIsOne(millerLoop(p, c));
+}
+
+// Multi pairings can be split into shards (e.g. across processes or machines): each shard runs
+// millerLoop over its pairs and ships the result serialized with fp12::toBytesBE (576 bytes,
+// big endian, canonical). The partial products are multiplied here, and a single final
+// exponentiation is applied to the combination.
+fp12 pairing::combine(span<const fp12> partials)
+{
+    fp12 f = fp12::one();
+    for(const fp12& partial : partials)
+    {
+        f.mulAssign(partial);
+    }
+    return f;
+}
+
+fp12 pairing::calculateCombined(span<const fp12> partials)
+{
+    fp12 f = combine(partials);
+    finalExp(f);
+    return f;
+}
+
+bool pairing::checkCombined(span<const fp12> partials)
+{
+    return finalExpIsOne(combine(partials));
+}
+
+// The points are stored as given, millerLoop normalizes all pairs at once
 void pairing::addPair(vector<tuple<g1, g2>>& pairs, const g1& e1, const g2& e2)
 {
-    if(!(g1(e1).isZero() || g2(e2).isZero()))
+    if(!(e1.isZero() || e2.isZero()))
     {
-        pairs.push_back({
-            g1(e1).affine(),
-            g2(e2).affine()
-        });
+        pairs.push_back({e1, e2});
     }
 }
 
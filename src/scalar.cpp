@@ -45,6 +45,7 @@ string bytesToHex(const vector<uint8_t>& in)
 // HELPER FUNCTIONS
 // for p mod q calculations
 #define RLC_MASK(B) ((-(uint64_t)((B) >= 64)) | (((uint64_t)1 << ((B) % 64)) - 1))
+#define RLC_DV_DIGS 24
 uint64_t bn_lshb_low(uint64_t *c, const uint64_t *a, int size, int bits)
 {
     int i;
@@ -230,11 +231,21 @@ uint64_t bn_rshb_low(uint64_t *c, const uint64_t *a, int size, int bits)
     return carry;
 }
 
-void bn_divn_low(uint64_t *c, uint64_t *d, uint64_t *a, int sa, uint64_t *b, int sb)
+void bn_divn_low(uint64_t *c, uint64_t *d, uint64_t *_a, int sa, uint64_t *_b, int sb)
 {
     int norm, i, n, t, sd;
     uint64_t carry, t1[3], t2[3];
 
+    // Normalization and alignment below may grow both operands by one digit and the
+    // shifted divisor spans the whole dividend, so work on zero padded copies.
+    if(sa + 2 > RLC_DV_DIGS || sb > sa)
+    {
+        throw invalid_argument("bn_divn_low: invalid operand sizes!");
+    }
+    uint64_t a[RLC_DV_DIGS] = {0}, b[RLC_DV_DIGS] = {0}, r[RLC_DV_DIGS] = {0};
+    memcpy(a, _a, sa * sizeof(uint64_t));
+    memcpy(b, _b, sb * sizeof(uint64_t));
+
     // Normalize x and y so that the leading digit of y is bigger than 2^(RLC_DIG-1).
     norm = (64 - __builtin_clzll(b[sb - 1])) % 64;
 
@@ -307,14 +318,14 @@ void bn_divn_low(uint64_t *c, uint64_t *d, uint64_t *a, int sa, uint64_t *b, int
         }
         while(dv_cmp(t1, t2, 3) == 1);
 
-        carry = bn_mul1_low(d, b, c[i - t - 1], sb);
+        carry = bn_mul1_low(r, b, c[i - t - 1], sb);
         sd = sb;
         if(carry)
         {
-            d[sd++] = carry;
+            r[sd++] = carry;
         }
 
-        carry = bn_subn_low(a + (i - t - 1), a + (i - t - 1), d, sd);
+        carry = bn_subn_low(a + (i - t - 1), a + (i - t - 1), r, sd);
         sd += (i - t - 1);
         if(sa - sd > 0)
         {
@@ -333,4 +344,75 @@ void bn_divn_low(uint64_t *c, uint64_t *d, uint64_t *a, int sa, uint64_t *b, int
     bn_rshb_low(d, a, sb, norm);
 }
 
+namespace scalar
+{
+
+static const uint64_t ORDER_INP = 0xfffffffeffffffff;   // ORDER_INP = -(q^{-1} mod 2^64) mod 2^64
+
+const array<uint64_t, 4> ORDER_R2 = {0xc999e990f3f29c6d, 0x2b6cedcb87925c23, 0x05d314967254398f, 0x0748d9d99f59ff11};
+
+static void subOrder(array<uint64_t, 4>& a)
+{
+    uint64_t borrow = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        tie(a[i], borrow) = Sub64(a[i], fp::Q[i], borrow);
+    }
+}
+
+array<uint64_t, 4> montMulModOrder(const array<uint64_t, 4>& a, const array<uint64_t, 4>& b)
+{
+    uint64_t t[6] = {0, 0, 0, 0, 0, 0};
+    uint64_t hi, lo, carry, c, m, _;
+    for(size_t i = 0; i < 4; i++)
+    {
+        // t += a * b[i]
+        c = 0;
+        for(size_t j = 0; j < 4; j++)
+        {
+            tie(hi, lo) = madd1(a[j], b[i], c);
+            tie(t[j], carry) = Add64(t[j], lo, 0);
+            tie(c, _) = Add64(hi, 0, carry);
+        }
+        tie(t[4], t[5]) = Add64(t[4], c, 0);
+        // t = (t + m * q) / 2^64
+        m = t[0] * ORDER_INP;
+        c = madd0(m, fp::Q[0], t[0]);
+        for(size_t j = 1; j < 4; j++)
+        {
+            tie(c, t[j - 1]) = madd2(m, fp::Q[j], t[j], c);
+        }
+        tie(t[3], carry) = Add64(t[4], c, 0);
+        t[4] = t[5] + carry;
+    }
+    array<uint64_t, 4> r = {t[0], t[1], t[2], t[3]};
+    if(t[4] != 0 || cmp<4>(r, fp::Q) >= 0)
+    {
+        subOrder(r);
+    }
+    return r;
+}
+
+void reduceModOrder(array<uint64_t, 4>& a)
+{
+    while(cmp<4>(a, fp::Q) >= 0)
+    {
+        subOrder(a);
+    }
+}
+
+array<uint64_t, 4> addModOrder(const array<uint64_t, 4>& a, const array<uint64_t, 4>& b)
+{
+    array<uint64_t, 4> r;
+    uint64_t carry = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        tie(r[i], carry) = Add64(a[i], b[i], carry);
+    }
+    reduceModOrder(r);
+    return r;
+}
+
+} // namespace scalar
+
 } // namespace bls12_381
@@ -2,6 +2,12 @@
 #include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 namespace bls12_381
 {
@@ -20,18 +26,35 @@ sha256::sha256(): m_blocklen(0), m_bitlen(0)
 
 void sha256::update(const uint8_t * data, size_t length)
 {
-    for(size_t i = 0 ; i < length ; i++)
+    // Complete a partially filled block first
+    if(m_blocklen > 0)
     {
-        m_data[m_blocklen++] = data[i];
-        if (m_blocklen == 64)
+        const size_t n = min(length, static_cast<size_t>(64 - m_blocklen));
+        memcpy(m_data + m_blocklen, data, n);
+        m_blocklen += n;
+        data += n;
+        length -= n;
+        if(m_blocklen < 64)
         {
-            transform();
-
-            // End of the block
-            m_bitlen += 512;
-            m_blocklen = 0;
+            return;
         }
+        transform(m_data, 1);
+        m_bitlen += 512;
+        m_blocklen = 0;
     }
+
+    // Whole blocks are compressed straight from the input
+    const size_t blocks = length / 64;
+    if(blocks > 0)
+    {
+        transform(data, blocks);
+        m_bitlen += 512 * blocks;
+        data += 64 * blocks;
+        length -= 64 * blocks;
+    }
+
+    memcpy(m_data, data, length);
+    m_blocklen = length;
 }
 
 void sha256::update(const string &data)
@@ -57,6 +80,47 @@ void sha256::digest(uint8_t* dst)
     revert(*phash);
 }
 
+array<uint32_t, 8> sha256::midstate() const
+{
+    if(m_blocklen != 0)
+    {
+        throw invalid_argument("sha256: midstate requires a whole number of blocks");
+    }
+    array<uint32_t, 8> state;
+    for(uint8_t i = 0 ; i < 8 ; i++)
+    {
+        state[i] = m_state[i];
+    }
+    return state;
+}
+
+sha256 sha256::fromMidstate(const array<uint32_t, 8>& state, const uint64_t length)
+{
+    if(length % 64 != 0)
+    {
+        throw invalid_argument("sha256: midstate length must be a multiple of the block size");
+    }
+    sha256 s;
+    for(uint8_t i = 0 ; i < 8 ; i++)
+    {
+        s.m_state[i] = state[i];
+    }
+    s.m_bitlen = length * 8;
+    return s;
+}
+
+void sha256::compress(array<uint32_t, 8>& state, const uint8_t* data, size_t blocks)
+{
+    if(hardwareAccelerated())
+    {
+        transformShaNi(state.data(), data, blocks);
+    }
+    else
+    {
+        transformGeneric(state.data(), data, blocks);
+    }
+}
+
 uint32_t sha256::rotr(uint32_t x, uint32_t n)
 {
     return (x >> n) | (x << (32 - n));
@@ -82,54 +146,154 @@ uint32_t sha256::sig1(uint32_t x)
     return sha256::rotr(x, 17) ^ sha256::rotr(x, 19) ^ (x >> 10);
 }
 
-void sha256::transform()
+void sha256::transformGeneric(uint32_t* st, const uint8_t* data, size_t blocks)
 {
     uint32_t maj, xorA, ch, xorE, sum, newA, newE, m[64];
     uint32_t state[8];
 
-    for(uint8_t i = 0, j = 0; i < 16; i++, j += 4)
+    for(; blocks > 0; blocks--, data += 64)
     {
-        // Split data in 32 bit blocks for the 16 first words
-        m[i] = (m_data[j] << 24) | (m_data[j + 1] << 16) | (m_data[j + 2] << 8) | (m_data[j + 3]);
+        for(uint8_t i = 0, j = 0; i < 16; i++, j += 4)
+        {
+            // Split data in 32 bit blocks for the 16 first words
+            m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+        }
+
+        for(uint8_t k = 16 ; k < 64; k++)
+        {
+            // Remaining 48 blocks
+            m[k] = sha256::sig1(m[k - 2]) + m[k - 7] + sha256::sig0(m[k - 15]) + m[k - 16];
+        }
+
+        for(uint8_t i = 0 ; i < 8 ; i++)
+        {
+            state[i] = st[i];
+        }
+
+        for(uint8_t i = 0; i < 64; i++)
+        {
+            maj   = sha256::majority(state[0], state[1], state[2]);
+            xorA  = sha256::rotr(state[0], 2) ^ sha256::rotr(state[0], 13) ^ sha256::rotr(state[0], 22);
+
+            ch = choose(state[4], state[5], state[6]);
+
+            xorE  = sha256::rotr(state[4], 6) ^ sha256::rotr(state[4], 11) ^ sha256::rotr(state[4], 25);
+
+            sum  = m[i] + K[i] + state[7] + ch + xorE;
+            newA = xorA + maj + sum;
+            newE = state[3] + sum;
+
+            state[7] = state[6];
+            state[6] = state[5];
+            state[5] = state[4];
+            state[4] = newE;
+            state[3] = state[2];
+            state[2] = state[1];
+            state[1] = state[0];
+            state[0] = newA;
+        }
+
+        for(uint8_t i = 0 ; i < 8 ; i++)
+        {
+            st[i] += state[i];
+        }
     }
+}
+
+#if defined(__x86_64__)
+// Compression with the Intel SHA extensions. The state is kept as ABEF/CDGH register pairs as required by
+// sha256rnds2, which performs two rounds per instruction. The message schedule of each group of four words
+// is computed with sha256msg1/sha256msg2 from the previous four groups.
+__attribute__((target("sha,sse4.1")))
+void sha256::transformShaNi(uint32_t* st, const uint8_t* data, size_t blocks)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st)), 0xb1);   // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st + 4)), 0x1b); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);       // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);            // CDGH
 
-    for(uint8_t k = 16 ; k < 64; k++)
+    for(; blocks > 0; blocks--, data += 64)
     {
-        // Remaining 48 blocks
-        m[k] = sha256::sig1(m[k - 2]) + m[k - 7] + sha256::sig0(m[k - 15]) + m[k - 16];
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i w[4];
+
+#pragma GCC unroll 16
+        for(uint8_t g = 0; g < 16; g++)
+        {
+            if(g < 4)
+            {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), MASK);
+            }
+            else
+            {
+                // W[g] = msg2(msg1(W[g-4], W[g-3]) + W[g-2..g-1] shifted by one word, W[g-1])
+                __m128i x = _mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]);
+                x = _mm_add_epi32(x, _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+                w[g & 3] = _mm_sha256msg2_epu32(x, w[(g + 3) & 3]);
+            }
+            __m128i msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(K.data() + 4 * g)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
     }
 
-    for(uint8_t i = 0 ; i < 8 ; i++)
+    tmp = _mm_shuffle_epi32(state0, 0x1b);                  // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xb1);               // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);            // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);               // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(st), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(st + 4), state1);
+}
+
+static bool cpuHasShaNi()
+{
+    unsigned int a, b, c, d;
+    // SSSE3 and SSE4.1 (leaf 1, ecx) are needed for the shuffles and blends
+    if(!__get_cpuid(1, &a, &b, &c, &d) || !(c & (1u << 9)) || !(c & (1u << 19)))
     {
-        state[i] = m_state[i];
+        return false;
     }
-
-    for(uint8_t i = 0; i < 64; i++)
+    // SHA (leaf 7, ebx bit 29)
+    if(!__get_cpuid_count(7, 0, &a, &b, &c, &d))
     {
-        maj   = sha256::majority(state[0], state[1], state[2]);
-        xorA  = sha256::rotr(state[0], 2) ^ sha256::rotr(state[0], 13) ^ sha256::rotr(state[0], 22);
-
-        ch = choose(state[4], state[5], state[6]);
+        return false;
+    }
+    return (b & (1u << 29)) != 0;
+}
 
-        xorE  = sha256::rotr(state[4], 6) ^ sha256::rotr(state[4], 11) ^ sha256::rotr(state[4], 25);
+bool sha256::hardwareAccelerated()
+{
+    static const bool shaNi = cpuHasShaNi();
+    return shaNi;
+}
+#else
+void sha256::transformShaNi(uint32_t* st, const uint8_t* data, size_t blocks)
+{
+    transformGeneric(st, data, blocks);
+}
 
-        sum  = m[i] + K[i] + state[7] + ch + xorE;
-        newA = xorA + maj + sum;
-        newE = state[3] + sum;
+bool sha256::hardwareAccelerated()
+{
+    return false;
+}
+#endif
 
-        state[7] = state[6];
-        state[6] = state[5];
-        state[5] = state[4];
-        state[4] = newE;
-        state[3] = state[2];
-        state[2] = state[1];
-        state[1] = state[0];
-        state[0] = newA;
+void sha256::transform(const uint8_t* data, size_t blocks)
+{
+    if(hardwareAccelerated())
+    {
+        transformShaNi(m_state, data, blocks);
     }
-
-    for(uint8_t i = 0 ; i < 8 ; i++)
+    else
     {
-        m_state[i] += state[i];
+        transformGeneric(m_state, data, blocks);
     }
 }
 
@@ -147,7 +311,7 @@ void sha256::pad()
 
     if(m_blocklen >= 56)
     {
-        transform();
+        transform(m_data, 1);
         memset(m_data, 0, 56);
     }
 
@@ -161,7 +325,7 @@ void sha256::pad()
     m_data[58] = m_bitlen >> 40;
     m_data[57] = m_bitlen >> 48;
     m_data[56] = m_bitlen >> 56;
-    transform();
+    transform(m_data, 1);
 }
 
 void sha256::revert(array<uint8_t, 32>& hash)
@@ -177,6 +341,218 @@ void sha256::revert(array<uint8_t, 32>& hash)
     }
 }
 
+// Multi-buffer hashing: every SIMD lane runs its own sha256 instance. state[j][l] is word j of lane l and
+// blocks[l] points to the 64 byte block lane l compresses next.
+template<typename V, size_t L>
+__attribute__((always_inline)) inline void transformLanes(uint32_t (*state)[L], const uint8_t* const* blocks, const uint32_t* k)
+{
+    V w[16], s[8];
+    for(size_t t = 0; t < 16; t++)
+    {
+        uint32_t words[L];
+        for(size_t l = 0; l < L; l++)
+        {
+            const uint8_t* b = blocks[l] + 4 * t;
+            words[l] = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+        }
+        memcpy(&w[t], words, sizeof(V));
+    }
+    for(size_t j = 0; j < 8; j++)
+    {
+        memcpy(&s[j], state[j], sizeof(V));
+    }
+
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for(size_t i = 0; i < 64; i++)
+    {
+        if(i >= 16)
+        {
+            const V w2 = w[(i - 2) & 15];
+            const V w15 = w[(i - 15) & 15];
+            const V sig0 = ((w15 >> 7) | (w15 << 25)) ^ ((w15 >> 18) | (w15 << 14)) ^ (w15 >> 3);
+            const V sig1 = ((w2 >> 17) | (w2 << 15)) ^ ((w2 >> 19) | (w2 << 13)) ^ (w2 >> 10);
+            w[i & 15] += sig1 + w[(i - 7) & 15] + sig0;
+        }
+        const V xorE = ((e >> 6) | (e << 26)) ^ ((e >> 11) | (e << 21)) ^ ((e >> 25) | (e << 7));
+        const V xorA = ((a >> 2) | (a << 30)) ^ ((a >> 13) | (a << 19)) ^ ((a >> 22) | (a << 10));
+        const V sum = h + xorE + ((e & f) ^ (~e & g)) + k[i] + w[i & 15];
+        const V maj = (a & (b | c)) | (b & c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + sum;
+        d = c;
+        c = b;
+        b = a;
+        a = sum + xorA + maj;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+
+    for(size_t j = 0; j < 8; j++)
+    {
+        memcpy(state[j], &s[j], sizeof(V));
+    }
+}
+
+#if defined(__x86_64__)
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+typedef uint32_t u32x16 __attribute__((vector_size(64)));
+
+__attribute__((target("avx2")))
+static void transform8(uint32_t (*state)[8], const uint8_t* const* blocks, const uint32_t* k)
+{
+    transformLanes<u32x8, 8>(state, blocks, k);
+}
+
+__attribute__((target("avx512f")))
+static void transform16(uint32_t (*state)[16], const uint8_t* const* blocks, const uint32_t* k)
+{
+    transformLanes<u32x16, 16>(state, blocks, k);
+}
+#endif
+
+// Feeds the messages through L lanes. A lane that finished its message writes the digest and picks up the
+// next message, so messages of different lengths keep all lanes busy. Idle lanes hash a dummy block.
+template<size_t L>
+static void digestLanes(
+    void (*transform)(uint32_t (*)[L], const uint8_t* const*, const uint32_t*),
+    const uint32_t* k,
+    span<const span<const uint8_t>> msgs,
+    span<array<uint8_t, 32>> out,
+    const array<uint32_t, 8>& iv,
+    const uint64_t ivLength
+)
+{
+    struct lane
+    {
+        size_t msg;
+        const uint8_t* next;
+        size_t fullBlocks;
+        uint8_t tail[128];
+        size_t tailBlocks;
+        size_t tailPos;
+        bool active;
+    };
+    static const uint8_t dummy[64] = {0};
+    uint32_t state[8][L];
+    const uint8_t* blocks[L];
+    lane lanes[L];
+    size_t nextMsg = 0;
+    size_t active = 0;
+
+    auto start = [&](size_t l)
+    {
+        lane& ln = lanes[l];
+        ln.active = nextMsg < msgs.size();
+        if(!ln.active)
+        {
+            return;
+        }
+        ln.msg = nextMsg++;
+        const span<const uint8_t> m = msgs[ln.msg];
+        ln.next = m.data();
+        ln.fullBlocks = m.size() / 64;
+        const size_t rem = m.size() % 64;
+        memset(ln.tail, 0, sizeof(ln.tail));
+        memcpy(ln.tail, m.data() + 64 * ln.fullBlocks, rem);
+        ln.tail[rem] = 0x80;
+        ln.tailBlocks = rem < 56 ? 1 : 2;
+        ln.tailPos = 0;
+        const uint64_t bitlen = (ivLength + m.size()) * 8;
+        for(size_t i = 0; i < 8; i++)
+        {
+            ln.tail[64 * ln.tailBlocks - 1 - i] = bitlen >> (8 * i);
+        }
+        for(size_t j = 0; j < 8; j++)
+        {
+            state[j][l] = iv[j];
+        }
+        active++;
+    };
+
+    for(size_t l = 0; l < L; l++)
+    {
+        start(l);
+    }
+    while(active > 0)
+    {
+        for(size_t l = 0; l < L; l++)
+        {
+            const lane& ln = lanes[l];
+            blocks[l] = !ln.active ? dummy : ln.fullBlocks > 0 ? ln.next : ln.tail + 64 * ln.tailPos;
+        }
+        transform(state, blocks, k);
+        for(size_t l = 0; l < L; l++)
+        {
+            lane& ln = lanes[l];
+            if(!ln.active)
+            {
+                continue;
+            }
+            if(ln.fullBlocks > 0)
+            {
+                ln.next += 64;
+                ln.fullBlocks--;
+            }
+            else if(++ln.tailPos == ln.tailBlocks)
+            {
+                for(size_t j = 0; j < 8; j++)
+                {
+                    out[ln.msg][4 * j]     = state[j][l] >> 24;
+                    out[ln.msg][4 * j + 1] = state[j][l] >> 16;
+                    out[ln.msg][4 * j + 2] = state[j][l] >> 8;
+                    out[ln.msg][4 * j + 3] = state[j][l];
+                }
+                active--;
+                start(l);
+            }
+        }
+    }
+}
+
+void sha256::digestMany(span<const span<const uint8_t>> msgs, span<array<uint8_t, 32>> out)
+{
+    digestMany(msgs, out, sha256().midstate(), 0);
+}
+
+void sha256::digestMany(
+    span<const span<const uint8_t>> msgs,
+    span<array<uint8_t, 32>> out,
+    const array<uint32_t, 8>& state,
+    const uint64_t length,
+    const size_t maxLanes
+)
+{
+    if(out.size() < msgs.size())
+    {
+        throw invalid_argument("sha256: digestMany needs an output for every message");
+    }
+    if(length % 64 != 0)
+    {
+        throw invalid_argument("sha256: midstate length must be a multiple of the block size");
+    }
+#if defined(__x86_64__)
+    static const bool avx512 = __builtin_cpu_supports("avx512f");
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if(avx512 && maxLanes >= 16 && msgs.size() >= 8)
+    {
+        digestLanes<16>(transform16, K.data(), msgs, out, state, length);
+        return;
+    }
+    if(avx2 && maxLanes >= 8 && msgs.size() >= 4)
+    {
+        digestLanes<8>(transform8, K.data(), msgs, out, state, length);
+        return;
+    }
+#endif
+    for(size_t i = 0; i < msgs.size(); i++)
+    {
+        sha256 s = fromMidstate(state, length);
+        s.update(msgs[i].data(), msgs[i].size());
+        out[i] = s.digest();
+    }
+}
+
 string sha256::toString(const array<uint8_t, 32>& digest)
 {
     stringstream s;
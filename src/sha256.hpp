@@ -2,6 +2,8 @@
 
 #include <string>
 #include <array>
+#include <cstdint>
+#include <span>
 
 using namespace std;
 
@@ -18,8 +20,34 @@ public:
     array<uint8_t, 32> digest();
     void digest(uint8_t* dst);
 
+    // Midstate: the chaining state after a whole number of 64 byte blocks. It can be exported and restored
+    // later to resume hashing without absorbing a constant prefix again ('length' is the prefix length in bytes).
+    array<uint32_t, 8> midstate() const;
+    static sha256 fromMidstate(const array<uint32_t, 8>& state, const uint64_t length);
+    // Compresses whole 64 byte blocks into a midstate. The caller provides the padding, e.g. a precomputed tail.
+    static void compress(array<uint32_t, 8>& state, const uint8_t* data, size_t blocks);
+
+    // Hashes independent messages at once: out[i] = sha256(msgs[i]), optionally resumed from a common midstate.
+    // The messages are interleaved in 16 (AVX-512) or 8 (AVX2) SIMD lanes where the CPU supports it,
+    // 'maxLanes' caps the width (e.g. to exercise the 8 lane path on AVX-512 hosts).
+    static void digestMany(span<const span<const uint8_t>> msgs, span<array<uint8_t, 32>> out);
+    static void digestMany(
+        span<const span<const uint8_t>> msgs,
+        span<array<uint8_t, 32>> out,
+        const array<uint32_t, 8>& state,
+        const uint64_t length,
+        const size_t maxLanes = 16
+    );
+
     static string toString(const array<uint8_t, 32>& digest);
 
+    // True if the compression function uses the Intel SHA extensions (SHA-NI) of this CPU
+    static bool hardwareAccelerated();
+    // Both compression functions (state += compress(blocks of 64 bytes)), independent of the dispatch in
+    // transform(), so that tests can compare them. transformShaNi requires hardwareAccelerated().
+    static void transformGeneric(uint32_t* state, const uint8_t* data, size_t blocks);
+    static void transformShaNi(uint32_t* state, const uint8_t* data, size_t blocks);
+
 private:
     uint8_t  m_data[64];
     uint32_t m_blocklen;
@@ -50,7 +78,7 @@ private:
     static uint32_t majority(uint32_t a, uint32_t b, uint32_t c);
     static uint32_t sig0(uint32_t x);
     static uint32_t sig1(uint32_t x);
-    void transform();
+    void transform(const uint8_t* data, size_t blocks);
     void pad();
     void revert(array<uint8_t, 32>& hash);
 };
@@ -1,6 +1,14 @@
 #include "../include/bls12_381.hpp"
 #include "sha256.hpp"
+#include "thread_pool.hpp"
 #include <set>
+#include <algorithm>
+#include <unordered_map>
+#include <string_view>
+#include <random>
+#include <cstring>
+#include <atomic>
+#include <thread>
 
 namespace bls12_381
 {
@@ -199,11 +207,7 @@ array<uint64_t, 4> secret_key(const vector<uint8_t>& seed)
 
     // Make sure private key is less than the curve order
     array<uint64_t, 6> skBn = scalar::fromBytesBE<6>(span<uint8_t, 48>(okmHkdf.begin(), okmHkdf.end()));
-    array<uint64_t, 6> quotient = {0, 0, 0, 0, 0, 0};
-    array<uint64_t, 6> remainder = {0, 0, 0, 0, 0, 0};
-    array<uint64_t, 4> q = fp::Q;
-    bn_divn_low(quotient.data(), remainder.data(), skBn.data(), 6, q.data(), 4);
-    array<uint64_t, 4> k = {remainder[0], remainder[1], remainder[2], remainder[3]};
+    array<uint64_t, 4> k = scalar::modOrder(skBn);
 
     free(ikmHkdf);
 
@@ -250,21 +254,20 @@ void parent_sk_to_lamport_pk(
     ikm_to_lamport_sk(lamport0.data(), ikm.data(), 32, salt.data(), 4);
     ikm_to_lamport_sk(lamport1.data(), notIkm.data(), 32, salt.data(), 4);
 
+    // The 510 chunk hashes are independent and run in parallel SIMD lanes
     array<uint8_t, 32 * 255 * 2> lamportPk;
-
+    vector<span<const uint8_t>> chunks;
+    chunks.reserve(255 * 2);
     for(size_t i = 0; i < 255; i++)
     {
-        sha256 sha;
-        sha.update(lamport0.data() + i * 32, 32);
-        sha.digest(lamportPk.data() + i * 32);
+        chunks.emplace_back(lamport0.data() + i * 32, 32);
     }
-
-    for(size_t i=0; i < 255; i++)
+    for(size_t i = 0; i < 255; i++)
     {
-        sha256 sha;
-        sha.update(lamport1.data() + i * 32, 32);
-        sha.digest(lamportPk.data() + 255 * 32 + i * 32);
+        chunks.emplace_back(lamport1.data() + i * 32, 32);
     }
+    sha256::digestMany(chunks, span<array<uint8_t, 32>>(reinterpret_cast<array<uint8_t, 32>*>(lamportPk.data()), 255 * 2));
+
     sha256 sha;
     sha.update(lamportPk.data(), 32 * 255 * 2);
     sha.digest(outputLamportPk);
@@ -321,11 +324,7 @@ g1 derive_shild_g1_unhardened(
     sha.digest(digest.data());
 
     array<uint64_t, 4> nonce = scalar::fromBytesBE<4>(span<uint8_t, 32>(digest.begin(), digest.end()));
-    array<uint64_t, 4> quotient = {0, 0, 0, 0};
-    array<uint64_t, 4> remainder = {0, 0, 0, 0};
-    array<uint64_t, 4> q = fp::Q;
-    bn_divn_low(quotient.data(), remainder.data(), nonce.data(), 4, q.data(), 4);
-    nonce = {remainder[0], remainder[1], remainder[2], remainder[3]};
+    nonce = scalar::modOrder(nonce);
 
     return g1(pk).add(g1::one().mulScalar(nonce));
 }
@@ -348,11 +347,7 @@ g2 derive_child_g2_unhardened(
     sha.digest(digest.data());
 
     array<uint64_t, 4> nonce = scalar::fromBytesBE<4>(span<uint8_t, 32>(digest.begin(), digest.end()));
-    array<uint64_t, 4> quotient = {0, 0, 0, 0};
-    array<uint64_t, 4> remainder = {0, 0, 0, 0};
-    array<uint64_t, 4> q = fp::Q;
-    bn_divn_low(quotient.data(), remainder.data(), nonce.data(), 4, q.data(), 4);
-    nonce = {remainder[0], remainder[1], remainder[2], remainder[3]};
+    nonce = scalar::modOrder(nonce);
 
     return g2(pk).add(g2::one().mulScalar(nonce));
 }
@@ -368,11 +363,7 @@ array<uint64_t, 4> aggregate_secret_keys(const vector<array<uint64_t, 4>>& sks)
     for(uint64_t i = 0; i < sks.size(); i++)
     {
         ret = scalar::add<4, 4, 4>(ret, sks[i]);
-        array<uint64_t, 4> quotient = {0, 0, 0, 0};
-        array<uint64_t, 4> remainder = {0, 0, 0, 0};
-        array<uint64_t, 4> q = fp::Q;
-        bn_divn_low(quotient.data(), remainder.data(), ret.data(), 4, q.data(), 4);
-        ret = {remainder[0], remainder[1], remainder[2], remainder[3]};
+        ret = scalar::modOrder(ret);
     }
 
     return ret;
@@ -392,11 +383,7 @@ array<uint64_t, 4> sk_from_bytes(
 
     if(modOrder)
     {
-        array<uint64_t, 4> quotient = {0, 0, 0, 0};
-        array<uint64_t, 4> remainder = {0, 0, 0, 0};
-        array<uint64_t, 4> q = fp::Q;
-        bn_divn_low(quotient.data(), remainder.data(), sk.data(), 4, q.data(), 4);
-        sk = {remainder[0], remainder[1], remainder[2], remainder[3]};
+        sk = scalar::modOrder(sk);
     }
     else
     {
@@ -411,68 +398,353 @@ array<uint64_t, 4> sk_from_bytes(
 
 g1 public_key(const array<uint64_t, 4>& sk)
 {
-    return g1::one().mulScalar(sk).affine();
+    // the secret key is only multiplied with branch-free formulas, and the result normalized in constant time
+    return g1_projective(g1::one()).mulScalar(sk).affine();
 }
 
-// Construct an extensible-output function based on SHA256
-void xmd_sh256(
+// Midstate of sha256 after absorbing Z_pad, the 64 zero bytes every expand_message_xmd hash starts with
+static array<uint32_t, 8> zPadMidstate()
+{
+    static const array<uint32_t, 8> state = []()
+    {
+        const uint8_t Z_pad[64] = { 0, };
+        sha256 sha;
+        sha.update(Z_pad, 64);
+        return sha.midstate();
+    }();
+    return state;
+}
+
+hash_to_curve_context::hash_to_curve_context(const string& dst) :
+    m_dst(dst),
+    m_dstPrime(dst.begin(), dst.end()),
+    m_zPadState(zPadMidstate())
+{
+    m_dstPrime.push_back(static_cast<uint8_t>(dst.length()));
+    const uint64_t len = 32 + 1 + m_dstPrime.size();
+    m_biBlocks.assign((len + 9 + 63) / 64 * 64, 0);
+    memcpy(&m_biBlocks[33], m_dstPrime.data(), m_dstPrime.size());
+    m_biBlocks[len] = 0x80;
+    for(uint64_t i = 0; i < 8; i++)
+    {
+        m_biBlocks[m_biBlocks.size() - 1 - i] = (len * 8) >> (8 * i);
+    }
+}
+
+const string& hash_to_curve_context::dst() const
+{
+    return m_dst;
+}
+
+void hash_to_curve_context::expandMessageXmd(
     uint8_t *buf,
     int buf_len,
     const uint8_t *in,
-    int in_len,
-    const uint8_t *dst,
-    int dst_len
-)
+    int in_len
+) const
 {
     const unsigned int SHA256HashSize = 32;
     const unsigned int SHA256_Message_Block_Size = 64;
     const unsigned ell = (buf_len + SHA256HashSize - 1) / SHA256HashSize;
-    if (buf_len < 0 || ell > 255 || dst_len > 255)
+    if (buf_len < 0 || ell > 255 || m_dst.length() > 255)
     {
         return;
     }
-    const uint8_t Z_pad[SHA256_Message_Block_Size] = { 0, };
     const uint8_t l_i_b_0_str[] = {
         static_cast<uint8_t>(buf_len >> 8),
         static_cast<uint8_t>(buf_len & 0xff),
-        0,
-        static_cast<uint8_t>(dst_len)
+        0
     };
-    const uint8_t *dstlen_str = l_i_b_0_str + 3;
     uint8_t b_0[SHA256HashSize];
-    sha256 sha;
-    sha.update(Z_pad, SHA256_Message_Block_Size);
+    sha256 sha = sha256::fromMidstate(m_zPadState, SHA256_Message_Block_Size);
     sha.update(in, in_len);
     sha.update(l_i_b_0_str, 3);
-    sha.update(dst, dst_len);
-    sha.update(dstlen_str, 1);
+    sha.update(m_dstPrime.data(), m_dstPrime.size());
     sha.digest(b_0);
-    uint8_t b_i[SHA256HashSize + 1] = { 0, };
+    // b_i = H((b_0 xor b_(i-1)) || I2OSP(i, 1) || DST'), compressed straight from the padded tail blocks
+    static const array<uint32_t, 8> iv = sha256().midstate();
+    uint8_t blocks[5 * SHA256_Message_Block_Size];
+    memcpy(blocks, m_biBlocks.data(), m_biBlocks.size());
+    uint8_t b_i[SHA256HashSize] = { 0, };
     for (unsigned i = 1; i <= ell; ++i)
     {
         for (unsigned j = 0; j < SHA256HashSize; ++j)
         {
-            b_i[j] = b_0[j] ^ b_i[j];
+            blocks[j] = b_0[j] ^ b_i[j];
+        }
+        blocks[SHA256HashSize] = i;
+        array<uint32_t, 8> state = iv;
+        sha256::compress(state, blocks, m_biBlocks.size() / SHA256_Message_Block_Size);
+        for (unsigned j = 0; j < SHA256HashSize; ++j)
+        {
+            b_i[j] = state[j / 4] >> (24 - 8 * (j % 4));
         }
-        b_i[SHA256HashSize] = i;
-        sha256 s;
-        s.update(b_i, SHA256HashSize + 1);
-        s.update(dst, dst_len);
-        s.update(dstlen_str, 1);
-        s.digest(b_i);
         const int rem_after = buf_len - i * SHA256HashSize;
         const int copy_len = SHA256HashSize + (rem_after < 0 ? rem_after : 0);
         memcpy(buf + (i - 1) * SHA256HashSize, b_i, copy_len);
     }
 }
 
+void hash_to_curve_context::expandMessageXmd(
+    uint8_t *buf,
+    int buf_len,
+    span<const vector<uint8_t>> msgs
+) const
+{
+    const unsigned int SHA256HashSize = 32;
+    const unsigned int SHA256_Message_Block_Size = 64;
+    const unsigned ell = (buf_len + SHA256HashSize - 1) / SHA256HashSize;
+    if (buf_len < 0 || ell > 255 || m_dst.length() > 255)
+    {
+        return;
+    }
+    const uint8_t l_i_b_0_str[] = {
+        static_cast<uint8_t>(buf_len >> 8),
+        static_cast<uint8_t>(buf_len & 0xff),
+        0
+    };
+    const size_t n = msgs.size();
+
+    // b_0 = H(Z_pad || msg || l_i_b_0_str || DST'), resumed from the Z_pad midstate
+    vector<vector<uint8_t>> b_0_in(n);
+    vector<span<const uint8_t>> in(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        b_0_in[j].reserve(msgs[j].size() + 3 + m_dstPrime.size());
+        b_0_in[j].insert(b_0_in[j].end(), msgs[j].begin(), msgs[j].end());
+        b_0_in[j].insert(b_0_in[j].end(), l_i_b_0_str, l_i_b_0_str + 3);
+        b_0_in[j].insert(b_0_in[j].end(), m_dstPrime.begin(), m_dstPrime.end());
+        in[j] = b_0_in[j];
+    }
+    vector<array<uint8_t, SHA256HashSize>> b_0(n);
+    sha256::digestMany(in, b_0, m_zPadState, SHA256_Message_Block_Size);
+
+    // b_i = H((b_0 xor b_(i-1)) || I2OSP(i, 1) || DST')
+    const size_t b_i_len = SHA256HashSize + 1 + m_dstPrime.size();
+    vector<uint8_t> b_i_in(n * b_i_len);
+    vector<array<uint8_t, SHA256HashSize>> b_i(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        memcpy(&b_i_in[j * b_i_len + SHA256HashSize + 1], m_dstPrime.data(), m_dstPrime.size());
+        in[j] = span<const uint8_t>(&b_i_in[j * b_i_len], b_i_len);
+    }
+    for (unsigned i = 1; i <= ell; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            uint8_t *p = &b_i_in[j * b_i_len];
+            for (unsigned k = 0; k < SHA256HashSize; ++k)
+            {
+                p[k] = b_0[j][k] ^ (i == 1 ? 0 : b_i[j][k]);
+            }
+            p[SHA256HashSize] = i;
+        }
+        sha256::digestMany(in, b_i);
+        const int rem_after = buf_len - i * SHA256HashSize;
+        const int copy_len = SHA256HashSize + (rem_after < 0 ? rem_after : 0);
+        for (size_t j = 0; j < n; ++j)
+        {
+            memcpy(buf + j * buf_len + (i - 1) * SHA256HashSize, b_i[j].data(), copy_len);
+        }
+    }
+}
+
+const hash_to_curve_context CIPHERSUITE_CONTEXT(CIPHERSUITE_ID);
+const hash_to_curve_context POP_CIPHERSUITE_CONTEXT(POP_CIPHERSUITE_ID);
+
+// Construct an extensible-output function based on SHA256
+void xmd_sh256(
+    uint8_t *buf,
+    int buf_len,
+    const uint8_t *in,
+    int in_len,
+    const uint8_t *dst,
+    int dst_len
+)
+{
+    if (dst_len < 0 || dst_len > 255)
+    {
+        return;
+    }
+    hash_to_curve_context(string(reinterpret_cast<const char*>(dst), dst_len)).expandMessageXmd(buf, buf_len, in, in_len);
+}
+
+static message_cache messageCache(0);
+static atomic<bool> messageCachePrepared(false);
+
+void configure_message_cache(const size_t capacity, const bool prepared)
+{
+    messageCachePrepared = prepared;
+    messageCache.setCapacity(capacity);
+}
+
+message_cache& hashed_message_cache()
+{
+    return messageCache;
+}
+
+// Hashes the messages to G2 (g2::fromMessages) through the message cache if it is enabled
+static vector<shared_ptr<const hashed_message>> hash_messages(
+    span<const vector<uint8_t>> messages,
+    const hash_to_curve_context& ctx
+)
+{
+    vector<shared_ptr<const hashed_message>> res(messages.size());
+    const bool cached = messageCache.capacity() > 0;
+    const bool prepared = cached && messageCachePrepared;
+    vector<array<uint8_t, 32>> keys;
+    vector<size_t> missing;
+    vector<vector<uint8_t>> todo;
+    if(cached)
+    {
+        const uint8_t dstLen = ctx.dst().length();
+        keys.resize(messages.size());
+        for(size_t i = 0; i < messages.size(); i++)
+        {
+            // the length comes first, so that no two (DST, message) pairs hash the same bytes
+            sha256 sha;
+            sha.update(&dstLen, 1);
+            sha.update(ctx.dst());
+            sha.update(messages[i].data(), messages[i].size());
+            keys[i] = sha.digest();
+            optional<shared_ptr<const hashed_message>> h = messageCache.find(keys[i]);
+            if(h)
+            {
+                res[i] = *h;
+                continue;
+            }
+            missing.push_back(i);
+            todo.push_back(messages[i]);
+        }
+    }
+    vector<g2> points = g2::fromMessages(cached ? span<const vector<uint8_t>>(todo) : messages, ctx);
+    g2::batchAffine(points);
+    for(size_t k = 0; k < points.size(); k++)
+    {
+        shared_ptr<hashed_message> h = make_shared<hashed_message>();
+        h->point = points[k];
+        if(prepared)
+        {
+            h->lines.emplace();
+            pairing::preCompute(*h->lines, points[k]);
+        }
+        if(cached)
+        {
+            res[missing[k]] = h;
+            messageCache.insert(keys[missing[k]], h);
+        }
+        else
+        {
+            res[k] = h;
+        }
+    }
+    return res;
+}
+
+static shared_ptr<const hashed_message> hash_message(const vector<uint8_t>& message, const hash_to_curve_context& ctx)
+{
+    return hash_messages(span<const vector<uint8_t>>(&message, 1), ctx)[0];
+}
+
+// Miller loop lines of hashed messages: the cached compact lines where present, full lines computed here
+// (and kept in 'computed') for the others. At most one of full[k] and compact[k] is set, none for a point at infinity.
+struct message_lines
+{
+    vector<array<array<fp2, 3>, 68>> computed;
+    vector<const array<array<fp2, 3>, 68>*> full;
+    vector<const array<array<fp2, 2>, 68>*> compact;
+};
+
+static void prepare_message_lines(message_lines& res, const vector<shared_ptr<const hashed_message>>& hashes)
+{
+    res.full.assign(hashes.size(), nullptr);
+    res.compact.assign(hashes.size(), nullptr);
+    vector<g2> q;
+    vector<size_t> qAt;
+    for(size_t k = 0; k < hashes.size(); k++)
+    {
+        if(hashes[k]->point.isZero())
+        {
+            continue;
+        }
+        if(hashes[k]->lines)
+        {
+            res.compact[k] = &*hashes[k]->lines;
+            continue;
+        }
+        q.push_back(hashes[k]->point);
+        qAt.push_back(k);
+    }
+    g2::batchAffine(q);
+    res.computed.resize(q.size());
+    for(size_t j = 0; j < q.size(); j++)
+    {
+        pairing::preCompute(res.computed[j], q[j]);
+        res.full[qAt[j]] = &res.computed[j];
+    }
+}
+
+// Miller loop of e(-g1, signature) * prod e(pks[i], H(m[i])) with the prepared lines of the messages m[i].
+// Pairs with a point at infinity are skipped.
+static fp12 hashed_miller_loop(
+    const g2& signature,
+    const vector<g1>& pks,
+    const message_lines& lines
+)
+{
+    vector<g1> p, pCompact;
+    vector<const array<array<fp2, 3>, 68>*> full;
+    vector<const array<array<fp2, 2>, 68>*> compact;
+    array<array<fp2, 3>, 68> signatureLines;
+    if(!signature.isZero())
+    {
+        g2 q = signature.affine();
+        pairing::preCompute(signatureLines, q);
+        p.push_back(g1::one().neg());
+        full.push_back(&signatureLines);
+    }
+    for(size_t i = 0; i < pks.size(); i++)
+    {
+        if(pks[i].isZero())
+        {
+            continue;
+        }
+        if(lines.full[i] != nullptr)
+        {
+            p.push_back(pks[i]);
+            full.push_back(lines.full[i]);
+        }
+        else if(lines.compact[i] != nullptr)
+        {
+            pCompact.push_back(pks[i]);
+            compact.push_back(lines.compact[i]);
+        }
+    }
+    // one inversion for the G1 points of both forms
+    const size_t nFull = p.size();
+    p.insert(p.end(), pCompact.begin(), pCompact.end());
+    g1::batchAffine(p);
+    return pairing::millerLoop(span<const g1>(p).first(nFull), full, span<const g1>(p).subspan(nFull), compact);
+}
+
+// Same as above with the lines of the hashes prepared here. The cached compact lines are used in place.
+static fp12 hashed_miller_loop(
+    const g2& signature,
+    const vector<g1>& pks,
+    const vector<shared_ptr<const hashed_message>>& hashes
+)
+{
+    message_lines lines;
+    prepare_message_lines(lines, hashes);
+    return hashed_miller_loop(signature, pks, lines);
+}
+
 g2 sign(
     const array<uint64_t, 4>& sk,
     const vector<uint8_t>& msg
 )
 {
-    g2 p = g2::fromMessage(msg, CIPHERSUITE_ID);
-    return p.mulScalar(sk);
+    return g2_projective(hash_message(msg, CIPHERSUITE_CONTEXT)->point).mulScalar(sk).affine();
 }
 
 bool verify(
@@ -481,11 +753,6 @@ bool verify(
     const g2& signature
 )
 {
-    vector<tuple<g1, g2>> v;
-    pairing::addPair(v, g1::one().neg(), signature);
-    const g2 hashedPoint = g2::fromMessage(message, CIPHERSUITE_ID);
-    pairing::addPair(v, pubkey, hashedPoint);
-
     if(!pubkey.isOnCurve() || !pubkey.inCorrectSubgroup())
     {
         return false;
@@ -496,39 +763,323 @@ bool verify(
     }
 
     // 1 =? prod e(pubkey[i], hash[i]) * e(-g1, aggSig)
-    return fp12::one().equal(pairing::calculate(v));
+    return pairing::finalExpIsOne(hashed_miller_loop(signature, {pubkey}, {hash_message(message, CIPHERSUITE_CONTEXT)}));
 }
 
-g1 aggregate_public_keys(const vector<g1>& pks)
+public_key_prepared::public_key_prepared(const g1& pk) : m_pk(pk.affine())
+{
+    if(!m_pk.isOnCurve() || !m_pk.inCorrectSubgroup())
+    {
+        throw invalid_argument("public_key_prepared: invalid public key");
+    }
+    m_compressed = m_pk.toCompressedBytesBE();
+}
+
+public_key_prepared::public_key_prepared(const g1& pk, const array<uint8_t, 48>& compressed) :
+    m_pk(pk),
+    m_compressed(compressed)
+{
+}
+
+public_key_prepared public_key_prepared::fromCompressedBytesBE(const span<const uint8_t, 48> in)
+{
+    // decompression already yields an affine point on the curve
+    const g1 pk = g1::fromCompressedBytesBE(in);
+    if(!pk.inCorrectSubgroup())
+    {
+        throw invalid_argument("public_key_prepared: invalid public key");
+    }
+    array<uint8_t, 48> compressed;
+    copy(in.begin(), in.end(), compressed.begin());
+    return public_key_prepared(pk, compressed);
+}
+
+const g1& public_key_prepared::point() const
+{
+    return m_pk;
+}
+
+const array<uint8_t, 48>& public_key_prepared::compressed() const
+{
+    return m_compressed;
+}
+
+bool verify(
+    const public_key_prepared& pubkey,
+    const vector<uint8_t>& message,
+    const g2& signature
+)
 {
-    g1 agg_pk = g1({fp::zero(), fp::zero(), fp::zero()});
-    for(const g1& pk : pks)
+    if(!signature.isOnCurve() || !signature.inCorrectSubgroup())
     {
-        agg_pk = agg_pk.add(pk);
+        return false;
     }
-    return agg_pk;
+
+    // 1 =? prod e(pubkey[i], hash[i]) * e(-g1, aggSig)
+    return pairing::finalExpIsOne(hashed_miller_loop(signature, {pubkey.point()}, {hash_message(message, CIPHERSUITE_CONTEXT)}));
+}
+
+// Sums up load(in[i]) for all i. The input is split into contiguous chunks that are accumulated on the shared
+// thread pool, adding affine points with mixed additions, and the partial sums are combined pairwise in a tree.
+// Exceptions thrown by 'load' are rethrown to the caller.
+template<typename G, typename T, typename L>
+static G parallel_sum(span<const T> in, L load)
+{
+    const size_t minChunk = 1024;
+    thread_pool& pool = thread_pool::instance();
+    const size_t numChunks = max<size_t>(1, min(pool.concurrency(), in.size() / minChunk));
+    vector<G> partials(numChunks, G::zero());
+    pool.run(numChunks, [&](size_t t)
+    {
+        const size_t lo = in.size() * t / numChunks;
+        const size_t hi = in.size() * (t + 1) / numChunks;
+        G acc = G::zero();
+        for(size_t i = lo; i < hi; i++)
+        {
+            acc = acc.addMixed(load(in[i]));
+        }
+        partials[t] = acc;
+    });
+    for(size_t step = 1; step < numChunks; step *= 2)
+    {
+        for(size_t t = 0; t + step < numChunks; t += 2 * step)
+        {
+            partials[t] = partials[t].add(partials[t + step]);
+        }
+    }
+    return partials[0];
+}
+
+g1 aggregate_public_keys(const vector<g1>& pks)
+{
+    return aggregate_public_keys(span<const g1>(pks));
+}
+
+g1 aggregate_public_keys(span<const g1> pks)
+{
+    return parallel_sum<g1>(pks, [](const g1& p) -> const g1& { return p; });
+}
+
+g1 aggregate_public_keys(span<const g1_affine> pks)
+{
+    return parallel_sum<g1>(pks, [](const g1_affine& p) -> const g1_affine& { return p; });
+}
+
+g1 aggregate_public_keys(span<const array<uint8_t, 48>> pks)
+{
+    return parallel_sum<g1>(pks, [](const array<uint8_t, 48>& b) { return g1::fromCompressedBytesBE(b); });
 }
 
 g2 aggregate_signatures(const vector<g2>& sigs)
 {
-    g2 agg_sig = g2({fp2::zero(), fp2::zero(), fp2::zero()});
-    for(const g2& sig : sigs)
+    return aggregate_signatures(span<const g2>(sigs));
+}
+
+g2 aggregate_signatures(span<const g2> sigs)
+{
+    return parallel_sum<g2>(sigs, [](const g2& p) -> const g2& { return p; });
+}
+
+g2 aggregate_signatures(span<const g2_affine> sigs)
+{
+    return parallel_sum<g2>(sigs, [](const g2_affine& p) -> const g2_affine& { return p; });
+}
+
+g2 aggregate_signatures(span<const array<uint8_t, 96>> sigs)
+{
+    return parallel_sum<g2>(sigs, [](const array<uint8_t, 96>& b) { return g2::fromCompressedBytesBE(b); });
+}
+
+template<typename G>
+aggregator<G>::aggregator(const size_t numShards) : m_shards(numShards == 0 ? 1 : numShards)
+{
+    for(unique_ptr<shard>& s : m_shards)
     {
-        agg_sig = agg_sig.add(sig);
+        s = make_unique<shard>();
+        s->sum = G::zero();
+        s->count = 0;
     }
-    return agg_sig;
 }
 
-bool aggregate_verify(
+template<typename G>
+void aggregator<G>::add(const G& p)
+{
+    shard& s = *m_shards[hash<thread::id>()(this_thread::get_id()) % m_shards.size()];
+    lock_guard<mutex> lock(s.m);
+    s.sum = s.sum.addMixed(p);
+    s.count++;
+}
+
+template<typename G>
+bool aggregator<G>::add(const size_t signer, const G& p)
+{
+    // a signer always maps to the same shard, which holds its index
+    shard& s = *m_shards[signer % m_shards.size()];
+    lock_guard<mutex> lock(s.m);
+    if(!s.signers.insert(signer).second)
+    {
+        return false;
+    }
+    s.sum = s.sum.addMixed(p);
+    s.count++;
+    return true;
+}
+
+template<typename G>
+void aggregator<G>::merge(const aggregator& other)
+{
+    if(&other == this)
+    {
+        throw invalid_argument("aggregator: cannot merge an aggregator into itself");
+    }
+    // snapshot of 'other' first, so that no two aggregators are ever locked at the same time
+    G sum = G::zero();
+    uint64_t count = 0;
+    vector<size_t> signers;
+    for(const unique_ptr<shard>& s : other.m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        sum = sum.add(s->sum);
+        count += s->count;
+        signers.insert(signers.end(), s->signers.begin(), s->signers.end());
+    }
+
+    vector<unique_lock<mutex>> locks;
+    locks.reserve(m_shards.size());
+    for(unique_ptr<shard>& s : m_shards)
+    {
+        locks.emplace_back(s->m);
+    }
+    for(size_t signer : signers)
+    {
+        if(m_shards[signer % m_shards.size()]->signers.count(signer) != 0)
+        {
+            throw invalid_argument("aggregator: merged aggregators must not share signers");
+        }
+    }
+    for(size_t signer : signers)
+    {
+        m_shards[signer % m_shards.size()]->signers.insert(signer);
+    }
+    m_shards[0]->sum = m_shards[0]->sum.add(sum);
+    m_shards[0]->count += count;
+}
+
+template<typename G>
+void aggregator<G>::clear()
+{
+    for(unique_ptr<shard>& s : m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        s->sum = G::zero();
+        s->count = 0;
+        s->signers.clear();
+    }
+}
+
+template<typename G>
+G aggregator<G>::aggregate() const
+{
+    G sum = G::zero();
+    for(const unique_ptr<shard>& s : m_shards)
+    {
+        G part;
+        {
+            lock_guard<mutex> lock(s->m);
+            part = s->sum;
+        }
+        sum = sum.add(part);
+    }
+    return sum;
+}
+
+template<typename G>
+G aggregator<G>::affine() const
+{
+    return aggregate().affine();
+}
+
+template<typename G>
+decltype(G().toCompressedBytesBE()) aggregator<G>::toCompressedBytesBE() const
+{
+    return aggregate().toCompressedBytesBE();
+}
+
+template<typename G>
+uint64_t aggregator<G>::count() const
+{
+    uint64_t n = 0;
+    for(const unique_ptr<shard>& s : m_shards)
+    {
+        lock_guard<mutex> lock(s->m);
+        n += s->count;
+    }
+    return n;
+}
+
+template class aggregator<g1>;
+template class aggregator<g2>;
+
+// Groups identical messages: group[k] receives the group of messages[idx[k]]. Returns the index of one
+// representative message per group.
+static vector<size_t> group_messages(
+    vector<size_t>& group,
+    const vector<vector<uint8_t>> &messages,
+    const vector<size_t>& idx
+)
+{
+    unordered_map<string_view, size_t> groups;
+    groups.reserve(idx.size());
+    vector<size_t> reps;
+    group.resize(idx.size());
+    for(size_t k = 0; k < idx.size(); k++)
+    {
+        const vector<uint8_t>& msg = messages[idx[k]];
+        auto [it, inserted] = groups.try_emplace(string_view(reinterpret_cast<const char*>(msg.data()), msg.size()), reps.size());
+        if(inserted)
+        {
+            reps.push_back(idx[k]);
+        }
+        group[k] = it->second;
+    }
+    return reps;
+}
+
+// Sums up the public keys that signed the same message, so that every distinct message is hashed and paired
+// only once (prod e(pk[i], H(m)) = e(sum pk[i], H(m))). pubkeys[k] belongs to messages[idx[k]]. Returns one
+// sum per distinct message in 'sums' and the hashes of the distinct messages in 'hashes'.
+static void sum_grouped_keys(
+    vector<g1>& sums,
+    vector<shared_ptr<const hashed_message>>& hashes,
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const vector<size_t>& idx
+)
+{
+    vector<size_t> group;
+    vector<size_t> reps = group_messages(group, messages, idx);
+    sums.assign(reps.size(), g1::zero());
+    for(size_t k = 0; k < idx.size(); k++)
+    {
+        sums[group[k]] = sums[group[k]].addMixed(pubkeys[k]);
+    }
+    vector<vector<uint8_t>> distinct;
+    distinct.reserve(reps.size());
+    for(size_t i : reps)
+    {
+        distinct.push_back(messages[i]);
+    }
+    hashes = hash_messages(distinct, CIPHERSUITE_CONTEXT);
+}
+
+// aggregate_verify without the public key checks
+static bool aggregate_verify_keys_checked(
     const vector<g1>& pubkeys,
     const vector<vector<uint8_t>> &messages,
     const g2& signature,
     const bool checkForDuplicateMessages
 )
 {
-    vector<tuple<g1, g2>> v;
-    pairing::addPair(v, g1::one().neg(), signature);
-
     if(!signature.isOnCurve() || !signature.inCorrectSubgroup())
     {
         return false;
@@ -554,25 +1105,307 @@ bool aggregate_verify(
         }
     }
 
+    vector<size_t> idx(pubkeys.size());
+    for(size_t i = 0; i < pubkeys.size(); i++)
+    {
+        idx[i] = i;
+    }
+
+    vector<g1> sums;
+    vector<shared_ptr<const hashed_message>> hashes;
+    sum_grouped_keys(sums, hashes, pubkeys, messages, idx);
+
+    // 1 =? prod e(pubkey[i], hash[i]) * e(-g1, aggSig)
+    return pairing::finalExpIsOne(hashed_miller_loop(signature, sums, hashes));
+}
+
+bool aggregate_verify(
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const g2& signature,
+    const bool checkForDuplicateMessages
+)
+{
+    for(const g1& pk : pubkeys)
+    {
+        if(!pk.isOnCurve() || !pk.inCorrectSubgroup())
+        {
+            return false;
+        }
+    }
+    return aggregate_verify_keys_checked(pubkeys, messages, signature, checkForDuplicateMessages);
+}
+
+bool aggregate_verify(
+    const vector<public_key_prepared>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const g2& signature,
+    const bool checkForDuplicateMessages
+)
+{
+    vector<g1> pks;
+    pks.reserve(pubkeys.size());
+    for(const public_key_prepared& pk : pubkeys)
+    {
+        pks.push_back(pk.point());
+    }
+    return aggregate_verify_keys_checked(pks, messages, signature, checkForDuplicateMessages);
+}
+
+bool aggregate_verify_partial(
+    fp12& partial,
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages
+)
+{
+    if(pubkeys.size() != messages.size())
+    {
+        return false;
+    }
+
+    vector<size_t> idx(pubkeys.size());
     for(size_t i = 0; i < pubkeys.size(); i++)
     {
         if(!pubkeys[i].isOnCurve() || !pubkeys[i].inCorrectSubgroup())
         {
             return false;
         }
-        pairing::addPair(v, pubkeys[i], g2::fromMessage(messages[i], CIPHERSUITE_ID));
+        idx[i] = i;
     }
 
-    // 1 =? prod e(pubkey[i], hash[i]) * e(-g1, aggSig)
-    return fp12::one().equal(pairing::calculate(v));
+    vector<g1> sums;
+    vector<shared_ptr<const hashed_message>> hashes;
+    sum_grouped_keys(sums, hashes, pubkeys, messages, idx);
+
+    partial = hashed_miller_loop(g2::zero(), sums, hashes);
+    return true;
+}
+
+bool aggregate_verify_combine(
+    const vector<fp12>& partials,
+    const g2& signature
+)
+{
+    if(!signature.isOnCurve() || !signature.inCorrectSubgroup())
+    {
+        return false;
+    }
+
+    // 1 =? prod partial[i] * e(-g1, aggSig)
+    const array<tuple<g1, g2>, 1> v = {{{g1::one().neg(), signature}}};
+    vector<fp12> f = partials;
+    f.push_back(pairing::millerLoop(v));
+    return pairing::checkCombined(f);
+}
+
+// Draws n random, non-zero 64 bit coefficients for batch verification: r[i] = sha256(seed || i),
+// with the seed taken from the system's entropy source
+static vector<array<uint64_t, 4>> batch_coefficients(const size_t n)
+{
+    array<uint32_t, 8> seed;
+    random_device rd;
+    for(uint32_t& w : seed)
+    {
+        w = rd();
+    }
+    vector<array<uint64_t, 4>> r(n, {0, 0, 0, 0});
+    for(uint64_t i = 0; i < n; i++)
+    {
+        sha256 h;
+        h.update(reinterpret_cast<const uint8_t*>(seed.data()), sizeof(seed));
+        h.update(reinterpret_cast<const uint8_t*>(&i), sizeof(i));
+        array<uint8_t, 32> d = h.digest();
+        memcpy(&r[i][0], d.data(), sizeof(uint64_t));
+        if(r[i][0] == 0)
+        {
+            r[i][0] = 1;
+        }
+    }
+    return r;
+}
+
+// Checks entries [lo, hi) of a batch using their Miller loop products f[i] = e'(r[i] * pubkey[i], hash[i])
+// and their scaled signatures rs[i] = r[i] * sig[i]
+static bool batch_verify_range(
+    const vector<fp12>& f,
+    const vector<g2>& rs,
+    const size_t lo,
+    const size_t hi
+)
+{
+    g2 sig = g2::zero();
+    for(size_t i = lo; i < hi; i++)
+    {
+        sig = sig.add(rs[i]);
+    }
+    const array<tuple<g1, g2>, 1> v = {{{g1::one().neg(), sig}}};
+    vector<fp12> partials(f.begin() + lo, f.begin() + hi);
+    partials.push_back(pairing::millerLoop(v));
+    return pairing::checkCombined(partials);
+}
+
+// Localizes the invalid entries of the range [lo, hi), which is known to fail, by bisection. If the left
+// half passes the right half must fail, so it does not have to be checked again.
+static void batch_verify_bisect(
+    const vector<fp12>& f,
+    const vector<g2>& rs,
+    const vector<size_t>& idx,
+    const size_t lo,
+    const size_t hi,
+    vector<size_t>& invalid
+)
+{
+    if(hi - lo == 1)
+    {
+        invalid.push_back(idx[lo]);
+        return;
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    if(batch_verify_range(f, rs, lo, mid))
+    {
+        batch_verify_bisect(f, rs, idx, mid, hi, invalid);
+        return;
+    }
+    batch_verify_bisect(f, rs, idx, lo, mid, invalid);
+    if(!batch_verify_range(f, rs, mid, hi))
+    {
+        batch_verify_bisect(f, rs, idx, mid, hi, invalid);
+    }
+}
+
+bool batch_verify(
+    const vector<g1>& pubkeys,
+    const vector<vector<uint8_t>> &messages,
+    const vector<g2>& signatures,
+    vector<size_t>* invalid
+)
+{
+    const size_t n = pubkeys.size();
+    if(invalid != nullptr)
+    {
+        invalid->clear();
+    }
+    if(n == 0 || messages.size() != n || signatures.size() != n)
+    {
+        return false;
+    }
+
+    // indices of all entries with valid points
+    vector<size_t> idx;
+    idx.reserve(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        if(!pubkeys[i].isOnCurve() || !pubkeys[i].inCorrectSubgroup() ||
+           !signatures[i].isOnCurve() || !signatures[i].inCorrectSubgroup())
+        {
+            if(invalid == nullptr)
+            {
+                return false;
+            }
+            invalid->push_back(i);
+            continue;
+        }
+        idx.push_back(i);
+    }
+    const size_t m = idx.size();
+    if(m == 0)
+    {
+        return false;
+    }
+
+    vector<array<uint64_t, 4>> r = batch_coefficients(m);
+    vector<g1> p;
+    p.reserve(m);
+    for(size_t i = 0; i < m; i++)
+    {
+        p.push_back(pubkeys[idx[i]].mulScalar(array<uint64_t, 1>{r[i][0]}));
+    }
+
+    // hash every distinct message once and sum up the randomized public keys of identical messages, so that
+    // every distinct message is paired once
+    vector<size_t> group;
+    vector<size_t> reps = group_messages(group, messages, idx);
+    vector<vector<uint8_t>> distinct;
+    distinct.reserve(reps.size());
+    for(size_t i : reps)
+    {
+        distinct.push_back(messages[i]);
+    }
+    vector<shared_ptr<const hashed_message>> hashes = hash_messages(distinct, CIPHERSUITE_CONTEXT);
+    vector<g1> sums(reps.size(), g1::zero());
+    for(size_t k = 0; k < m; k++)
+    {
+        sums[group[k]] = sums[group[k]].addMixed(p[k]);
+    }
+
+    // the lines of every distinct message are prepared once, for the combined check and for localizing
+    message_lines lines;
+    prepare_message_lines(lines, hashes);
+
+    // 1 =? prod e(r[i] * pubkey[i], hash[i]) * e(-g1, sum r[i] * sig[i])
+    g2 sig = g2::zero();
+    vector<g2> rs;
+    if(invalid == nullptr)
+    {
+        vector<g2> sigs;
+        sigs.reserve(m);
+        for(size_t i : idx)
+        {
+            sigs.push_back(signatures[i]);
+        }
+        sig = g2::multiExp(sigs, r, 64);
+    }
+    else
+    {
+        // keep the scaled signatures r[i] * sig[i] to check subsets of the batch
+        rs.reserve(m);
+        for(size_t i = 0; i < m; i++)
+        {
+            rs.push_back(signatures[idx[i]].mulScalar(array<uint64_t, 1>{r[i][0]}));
+            sig = sig.add(rs[i]);
+        }
+    }
+    if(pairing::finalExpIsOne(hashed_miller_loop(sig, sums, lines)))
+    {
+        return invalid == nullptr || invalid->empty();
+    }
+    if(invalid == nullptr)
+    {
+        return false;
+    }
+
+    // only if the combined check fails: the Miller loop product of every entry on its own, evaluated on the
+    // lines of its message, so that subsets can be checked without hashing or precomputing lines again
+    g1::batchAffine(p);
+    vector<fp12> f(m, fp12::one());
+    for(size_t i = 0; i < m; i++)
+    {
+        const size_t k = group[i];
+        if(p[i].isZero())
+        {
+            continue;
+        }
+        const size_t nFull = lines.full[k] != nullptr ? 1 : 0;
+        const size_t nCompact = lines.compact[k] != nullptr ? 1 : 0;
+        f[i] = pairing::millerLoop(
+            span<const g1>(&p[i], nFull),
+            span<const array<array<fp2, 3>, 68>* const>(&lines.full[k], nFull),
+            span<const g1>(&p[i], nCompact),
+            span<const array<array<fp2, 2>, 68>* const>(&lines.compact[k], nCompact)
+        );
+    }
+    // the whole range is known to fail (same equation and coefficients as the combined check)
+    batch_verify_bisect(f, rs, idx, 0, m, *invalid);
+    sort(invalid->begin(), invalid->end());
+    return false;
 }
 
 g2 pop_prove(const array<uint64_t, 4>& sk)
 {
     g1 pk = public_key(sk);
     array<uint8_t, 48> msg = pk.toCompressedBytesBE();
-    g2 hashed_key = g2::fromMessage(vector<uint8_t>(msg.begin(), msg.end()), POP_CIPHERSUITE_ID);
-    return hashed_key.mulScalar(sk);
+    g2 hashed_key = g2::fromMessage(vector<uint8_t>(msg.begin(), msg.end()), POP_CIPHERSUITE_CONTEXT);
+    return g2_projective(hashed_key).mulScalar(sk).affine();
 }
 
 bool pop_verify(
@@ -580,9 +1413,6 @@ bool pop_verify(
     const g2& signature_proof
 )
 {
-    array<uint8_t, 48> msg = pubkey.toCompressedBytesBE();
-    const g2 hashedPoint = g2::fromMessage(vector<uint8_t>(msg.begin(), msg.end()), POP_CIPHERSUITE_ID);
-
     if(!pubkey.isOnCurve() || !pubkey.inCorrectSubgroup())
     {
         return false;
@@ -592,12 +1422,15 @@ bool pop_verify(
         return false;
     }
 
-    vector<tuple<g1, g2>> v;
-    pairing::addPair(v, g1::one().neg(), signature_proof);
-    pairing::addPair(v, pubkey, hashedPoint);
+    array<uint8_t, 48> msg = pubkey.toCompressedBytesBE();
+    const g2 hashedPoint = g2::fromMessage(vector<uint8_t>(msg.begin(), msg.end()), POP_CIPHERSUITE_CONTEXT);
 
     // 1 =? prod e(pubkey[i], hash[i]) * e(-g1, aggSig)
-    return fp12::one().equal(pairing::calculate(v));
+    const array<tuple<g1, g2>, 2> v = {{
+        {g1::one().neg(), signature_proof},
+        {pubkey, hashedPoint}
+    }};
+    return pairing::check(v);
 }
 
 bool pop_fast_aggregate_verify(
@@ -614,4 +1447,185 @@ bool pop_fast_aggregate_verify(
     return verify(aggregate_public_keys(pubkeys), message, signature);
 }
 
+committee::committee(const vector<g1>& pubkeys) : m_members(g1_affine::fromJacobian(pubkeys)), m_total(aggregate_public_keys(pubkeys))
+{
+}
+
+size_t committee::size() const
+{
+    return m_members.size();
+}
+
+g1 committee::member(const size_t index) const
+{
+    if(index >= m_members.size())
+    {
+        throw invalid_argument("committee: member index out of range");
+    }
+    return g1(m_members[index]);
+}
+
+const g1& committee::aggregate() const
+{
+    return m_total;
+}
+
+g1 committee::aggregate(const vector<bool>& participation) const
+{
+    if(participation.size() != m_members.size())
+    {
+        throw invalid_argument("committee: participation size must match the committee size");
+    }
+    const size_t present = count(participation.begin(), participation.end(), true);
+    const bool subtract = m_members.size() - present < present;
+    g1 agg = subtract ? m_total : g1::zero();
+    for(size_t i = 0; i < m_members.size(); i++)
+    {
+        if(participation[i] != subtract)
+        {
+            agg = agg.addMixed(subtract ? m_members[i].neg() : m_members[i]);
+        }
+    }
+    return agg;
+}
+
+void committee::update(const size_t index, const g1& pubkey)
+{
+    if(index >= m_members.size())
+    {
+        throw invalid_argument("committee: member index out of range");
+    }
+    const g1_affine member(pubkey);
+    m_total = m_total.addMixed(m_members[index].neg()).addMixed(member);
+    m_members[index] = member;
+}
+
+bool pop_fast_aggregate_verify(
+    const committee& members,
+    const vector<bool>& participation,
+    const vector<uint8_t>& message,
+    const g2& signature
+)
+{
+    if(participation.size() != members.size() || count(participation.begin(), participation.end(), true) == 0)
+    {
+        return false;
+    }
+
+    return verify(members.aggregate(participation), message, signature);
+}
+
+verification_cache::verification_cache(
+    const size_t capacity,
+    const chrono::steady_clock::duration ttl,
+    const size_t numShards
+) :
+    m_entries(capacity, numShards),
+    m_ttl(ttl),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+bool verification_cache::contains(const array<uint8_t, 32>& key)
+{
+    optional<chrono::steady_clock::time_point> expiry = m_entries.find(key);
+    if(expiry && *expiry > chrono::steady_clock::now())
+    {
+        m_hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    if(expiry)
+    {
+        m_entries.erase(key);
+    }
+    m_misses.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void verification_cache::insert(const array<uint8_t, 32>& key)
+{
+    m_entries.insert(key, chrono::steady_clock::now() + m_ttl);
+}
+
+void verification_cache::clear()
+{
+    m_entries.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+size_t verification_cache::size() const
+{
+    return m_entries.size();
+}
+
+uint64_t verification_cache::hits() const
+{
+    return m_hits.load(memory_order_relaxed);
+}
+
+uint64_t verification_cache::misses() const
+{
+    return m_misses.load(memory_order_relaxed);
+}
+
+// Key of a verification: sha256(tag || infinity flags || pubkey || signature || message). The points enter
+// in their affine (uncompressed) encoding, because an invalid point can share its compressed encoding with
+// a valid one. The flags tell the point at infinity apart from (0, 0).
+static array<uint8_t, 32> verification_key(
+    const uint8_t tag,
+    const g1& pubkey,
+    const g2& signature,
+    const vector<uint8_t>& message
+)
+{
+    const uint8_t prefix[2] = {tag, static_cast<uint8_t>(pubkey.isZero() | signature.isZero() << 1)};
+    sha256 sha;
+    sha.update(prefix, 2);
+    sha.update(pubkey.toAffineBytesBE().data(), 96);
+    sha.update(signature.toAffineBytesBE().data(), 192);
+    sha.update(message.data(), message.size());
+    return sha.digest();
+}
+
+bool verify(
+    const g1& pubkey,
+    const vector<uint8_t>& message,
+    const g2& signature,
+    verification_cache& cache
+)
+{
+    const array<uint8_t, 32> key = verification_key(0, pubkey, signature, message);
+    if(cache.contains(key))
+    {
+        return true;
+    }
+    if(!verify(pubkey, message, signature))
+    {
+        return false;
+    }
+    cache.insert(key);
+    return true;
+}
+
+bool pop_verify(
+    const g1& pubkey,
+    const g2& signature_proof,
+    verification_cache& cache
+)
+{
+    const array<uint8_t, 32> key = verification_key(1, pubkey, signature_proof, {});
+    if(cache.contains(key))
+    {
+        return true;
+    }
+    if(!pop_verify(pubkey, signature_proof))
+    {
+        return false;
+    }
+    cache.insert(key);
+    return true;
+}
+
 } // namespace bls12_381
@@ -0,0 +1,116 @@
+#include "thread_pool.hpp"
+
+namespace bls12_381
+{
+
+thread_pool& thread_pool::instance()
+{
+    static thread_pool pool(max(thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+thread_pool::thread_pool(const size_t numWorkers) : m_stop(false)
+{
+    m_workers.reserve(numWorkers);
+    for(size_t i = 0; i < numWorkers; i++)
+    {
+        m_workers.emplace_back(&thread_pool::work, this);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(thread& w : m_workers)
+    {
+        w.join();
+    }
+}
+
+size_t thread_pool::concurrency() const
+{
+    return m_workers.size() + 1;
+}
+
+void thread_pool::run(const size_t n, const function<void(size_t)>& task)
+{
+    if(n <= 1 || m_workers.empty())
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+    shared_ptr<job> j = make_shared<job>();
+    j->task = &task;
+    j->n = n;
+    j->next = 0;
+    j->done = 0;
+    {
+        // one queue entry per worker that can help; entries that are dequeued after all tasks have been
+        // handed out find nothing left to do (the job outlives run() through the shared pointer)
+        lock_guard<mutex> lock(m_mutex);
+        for(size_t i = 0; i < min(n - 1, m_workers.size()); i++)
+        {
+            m_queue.push_back(j);
+        }
+    }
+    m_wake.notify_all();
+    execute(*j);
+    unique_lock<mutex> lock(j->m);
+    j->finished.wait(lock, [&]() { return j->done == n; });
+    if(j->error)
+    {
+        rethrow_exception(j->error);
+    }
+}
+
+void thread_pool::work()
+{
+    for(;;)
+    {
+        shared_ptr<job> j;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+            if(m_queue.empty())
+            {
+                return;
+            }
+            j = m_queue.front();
+            m_queue.pop_front();
+        }
+        execute(*j);
+    }
+}
+
+void thread_pool::execute(job& j)
+{
+    for(size_t i = j.next++; i < j.n; i = j.next++)
+    {
+        try
+        {
+            (*j.task)(i);
+        }
+        catch(...)
+        {
+            lock_guard<mutex> lock(j.m);
+            if(!j.error)
+            {
+                j.error = current_exception();
+            }
+        }
+        if(++j.done == j.n)
+        {
+            lock_guard<mutex> lock(j.m);
+            j.finished.notify_all();
+        }
+    }
+}
+
+} // namespace bls12_381
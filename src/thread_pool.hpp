@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace bls12_381
+{
+
+// Process wide pool of worker threads for the parallel parts of the library, created on first use. Concurrent
+// callers share its hardware_concurrency() - 1 workers instead of each starting threads of their own.
+class thread_pool
+{
+
+public:
+    static thread_pool& instance();
+    ~thread_pool();
+
+    // Number of threads that can work on a run() at once: the workers and the calling thread
+    size_t concurrency() const;
+    // Runs task(0), ..., task(n - 1) on the workers and the calling thread and returns once all of them have
+    // finished. The calling thread takes part, so tasks may call run() themselves. The first exception thrown
+    // by a task is rethrown here.
+    void run(const size_t n, const function<void(size_t)>& task);
+
+private:
+    struct job
+    {
+        const function<void(size_t)>* task;
+        size_t n;
+        atomic<size_t> next;
+        atomic<size_t> done;
+        mutex m;
+        condition_variable finished;
+        exception_ptr error;
+    };
+
+    explicit thread_pool(const size_t numWorkers);
+    void work();
+    static void execute(job& j);
+
+    vector<thread> m_workers;
+    mutex m_mutex;
+    condition_variable m_wake;
+    deque<shared_ptr<job>> m_queue;
+    bool m_stop;
+};
+
+} // namespace bls12_381
@@ -1,9 +1,13 @@
 #include <array>
 #include <vector>
 #include <random>
+#include <thread>
 #include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <bls12_381.hpp>
+#include "../src/sha256.hpp"
 
 using namespace std;
 using namespace bls12_381;
@@ -88,6 +92,47 @@ void TestScalar()
     }
 }
 
+void TestWideReduction()
+{
+    // compare the montgomery based reductions against long division
+    array<uint64_t, 8> ones;
+    ones.fill(0xffffffffffffffff);
+    for(int i = 0; i < 100; i++)
+    {
+        array<uint64_t, 8> k = ones;
+        if(i > 0)
+        {
+            array<uint64_t, 4> a = random_scalar(), b = random_scalar();
+            k = {a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3] | (static_cast<uint64_t>(i) << 58)};
+        }
+        array<uint64_t, 8> quotient = {0}, remainder = {0};
+        array<uint64_t, 6> p = fp::MODULUS.d;
+        bn_divn_low(quotient.data(), remainder.data(), k.data(), 8, p.data(), 6);
+        fp expected = fp({remainder[0], remainder[1], remainder[2], remainder[3], remainder[4], remainder[5]}).toMont();
+        if(!fp::modPrime(k).equal(expected))
+        {
+            throw invalid_argument("modPrime must match long division");
+        }
+
+        quotient = {0};
+        remainder = {0};
+        array<uint64_t, 4> q = fp::Q;
+        bn_divn_low(quotient.data(), remainder.data(), k.data(), 8, q.data(), 4);
+        if(scalar::modOrder(k) != array<uint64_t, 4>{remainder[0], remainder[1], remainder[2], remainder[3]})
+        {
+            throw invalid_argument("modOrder must match long division");
+        }
+        array<uint64_t, 4> k4 = {k[4], k[5], k[6], k[7]};
+        quotient = {0};
+        remainder = {0};
+        bn_divn_low(quotient.data(), remainder.data(), k4.data(), 4, q.data(), 4);
+        if(scalar::modOrder(k4) != array<uint64_t, 4>{remainder[0], remainder[1], remainder[2], remainder[3]})
+        {
+            throw invalid_argument("modOrder of 256 bit input must match long division");
+        }
+    }
+}
+
 void TestFieldElementValidation()
 {
     fp zero = fp::zero();
@@ -337,6 +382,49 @@ void TestFieldElementByteInputs()
 
 ///////////////////////////////////////////////////////////
 
+void TestFieldElementSparseMul()
+{
+    for(size_t i = 0; i < fuz; i++)
+    {
+        fp12 f = random_fe12();
+        fp2 a0 = random_fe2(), a1 = random_fe2(), a4 = random_fe2();
+        fp2 b0 = random_fe2(), b1 = random_fe2(), b4 = random_fe2();
+        // (f * a) * b == f * (a * b) with sparse a and b
+        fp12 expected = f;
+        expected.mulBy014Assign(a0, a1, a4);
+        expected.mulBy014Assign(b0, b1, b4);
+        fp12 ab = fp12::mul014By014(a0, a1, a4, b0, b1, b4);
+        fp12 r = f;
+        r.mulBy01245Assign(ab);
+        if(!r.equal(expected))
+        {
+            throw invalid_argument("sparse 014 by 014 multiplication failed");
+        }
+        if(!f.mul(ab).equal(expected))
+        {
+            throw invalid_argument("sparse 01245 multiplication failed");
+        }
+        // the same with a4 and b4 in the base field
+        fp x4 = random_fe(), y4 = random_fe();
+        expected = f;
+        expected.mulBy014Assign(a0, a1, fp2({x4, fp::zero()}));
+        expected.mulBy014Assign(b0, b1, fp2({y4, fp::zero()}));
+        r = f;
+        r.mulBy014Assign(a0, a1, x4);
+        r.mulBy014Assign(b0, b1, y4);
+        if(!r.equal(expected))
+        {
+            throw invalid_argument("sparse 014 multiplication with base field e4 failed");
+        }
+        r = f;
+        r.mulBy01245Assign(fp12::mul014By014(a0, a1, x4, b0, b1, y4));
+        if(!r.equal(expected))
+        {
+            throw invalid_argument("sparse 014 by 014 multiplication with base field e4 failed");
+        }
+    }
+}
+
 void TestG1Serialization()
 {
     for(uint64_t i = 0; i < fuz; i++)
@@ -449,6 +537,24 @@ void TestG1AdditiveProperties()
         {
             throw invalid_argument("a - b == - ( b - a )");
         }
+        t0 = a.add(b);
+        t1 = a.addMixed(b.affine());
+        if(!t0.equal(t1))
+        {
+            throw invalid_argument("a + b == a + affine(b)");
+        }
+        if(!a.addMixed(a.affine()).equal(a.dbl()) || !a.addMixed(a.neg().affine()).isZero())
+        {
+            throw invalid_argument("a + affine(a) == 2 * a, a + affine(-a) == 0");
+        }
+        if(!zero.addMixed(b.affine()).equal(b) || !a.addMixed(zero).equal(a))
+        {
+            throw invalid_argument("0 + affine(b) == b, a + 0 == a");
+        }
+        if(!a.dblN(3).equal(a.dbl().dbl().dbl()) || !a.dblN(0).equal(a) || !zero.dblN(5).isZero())
+        {
+            throw invalid_argument("dblN(3) == dbl(dbl(dbl())), dblN(0) == id, 0 * 2^n == 0");
+        }
         g1 c = random_g1();
         t0 = a.add(b);
         t0 = t0.add(c);
@@ -776,6 +882,24 @@ void TestG2AdditiveProperties()
         {
             throw invalid_argument("a - b == - ( b - a )");
         }
+        t0 = a.add(b);
+        t1 = a.addMixed(b.affine());
+        if(!t0.equal(t1))
+        {
+            throw invalid_argument("a + b == a + affine(b)");
+        }
+        if(!a.addMixed(a.affine()).equal(a.dbl()) || !a.addMixed(a.neg().affine()).isZero())
+        {
+            throw invalid_argument("a + affine(a) == 2 * a, a + affine(-a) == 0");
+        }
+        if(!zero.addMixed(b.affine()).equal(b) || !a.addMixed(zero).equal(a))
+        {
+            throw invalid_argument("0 + affine(b) == b, a + 0 == a");
+        }
+        if(!a.dblN(3).equal(a.dbl().dbl().dbl()) || !a.dblN(0).equal(a) || !zero.dblN(5).isZero())
+        {
+            throw invalid_argument("dblN(3) == dbl(dbl(dbl())), dblN(0) == id, 0 * 2^n == 0");
+        }
         g2 c = random_g2();
         t0 = a.add(b);
         t0 = t0.add(c);
@@ -925,6 +1049,141 @@ void TestG2MapToCurve()
         }
     }
 }
+void TestG2FromMessages()
+{
+    const string dst = "BLS_SIG_BLS12381G2_XMD:SHA-256_SSWU_RO_NUL_";
+    vector<vector<uint8_t>> msgs = {{}, {0}, {1, 2, 3}, vector<uint8_t>(200, 0x61), {1, 2, 3}};
+    vector<g2> hashes = g2::fromMessages(msgs, dst);
+    if(hashes.size() != msgs.size())
+    {
+        throw invalid_argument("G2: fromMessages returns wrong number of points");
+    }
+    for(uint64_t i = 0; i < msgs.size(); i++)
+    {
+        if(!hashes[i].equal(g2::fromMessage(msgs[i], dst)))
+        {
+            throw invalid_argument("G2: fromMessages must match fromMessage");
+        }
+    }
+    if(!g2::fromMessages(vector<vector<uint8_t>>(), dst).empty())
+    {
+        throw invalid_argument("G2: fromMessages of no messages must be empty");
+    }
+}
+
+void TestSha256Transforms()
+{
+    if(!sha256::hardwareAccelerated())
+    {
+        return;
+    }
+    random_device rd;
+    mt19937_64 gen(rd());
+    vector<uint8_t> buf(7 * 64 + 1);
+    for(uint8_t& b : buf)
+    {
+        b = gen();
+    }
+    for(size_t blocks : {1, 2, 7})
+    {
+        // unaligned input
+        const uint8_t* data = buf.data() + 1;
+        array<uint32_t, 8> generic = sha256().midstate(), shaNi = generic;
+        sha256::transformGeneric(generic.data(), data, blocks);
+        sha256::transformShaNi(shaNi.data(), data, blocks);
+        if(generic != shaNi)
+        {
+            throw invalid_argument("sha256: SHA-NI and generic compression differ");
+        }
+    }
+}
+
+void TestSha256DigestMany()
+{
+    // tail lengths around the padding boundaries of one and two blocks
+    const size_t lengths[] = {55, 56, 63, 64, 119, 120};
+    random_device rd;
+    mt19937_64 gen(rd());
+    vector<uint8_t> buf(120 * 17);
+    for(uint8_t& b : buf)
+    {
+        b = gen();
+    }
+    for(size_t lanes : {16, 8, 1})
+    {
+        for(size_t n : {1, 4, 8, 17})
+        {
+            vector<span<const uint8_t>> msgs;
+            for(size_t i = 0; i < n; i++)
+            {
+                msgs.push_back(span<const uint8_t>(buf.data() + 120 * i, lengths[(i + n) % 6]));
+            }
+            vector<array<uint8_t, 32>> out(n);
+            sha256::digestMany(msgs, out, sha256().midstate(), 0, lanes);
+            for(size_t i = 0; i < n; i++)
+            {
+                sha256 s;
+                s.update(msgs[i].data(), msgs[i].size());
+                if(out[i] != s.digest())
+                {
+                    throw invalid_argument("sha256: digestMany differs from single message hashing");
+                }
+            }
+        }
+    }
+}
+
+void TestExpandMessageXmd()
+{
+    // RFC 9380, appendix K.1
+    const hash_to_curve_context ctx("QUUX-V01-CS02-with-expander-SHA256-128");
+    const vector<pair<string, array<uint8_t, 32>>> vectors = {
+        {"", hexToBytes<32>("68a985b87eb6b46952128911f2a4412bbc302a9d759667f87f7a21d803f07235")},
+        {"abc", hexToBytes<32>("d8ccab23b5985ccea865c6c97b6e5b8350e794e603b4b97902f53a8a0d605615")},
+    };
+    for(const auto& v : vectors)
+    {
+        array<uint8_t, 32> out;
+        ctx.expandMessageXmd(out.data(), 32, reinterpret_cast<const uint8_t*>(v.first.data()), v.first.size());
+        if(out != v.second)
+        {
+            throw invalid_argument("expandMessageXmd does not match test vector");
+        }
+    }
+    // context and plain xmd_sh256 must agree
+    const vector<uint8_t> msg(100, 0x61);
+    array<uint8_t, 256> a, b;
+    CIPHERSUITE_CONTEXT.expandMessageXmd(a.data(), 256, msg.data(), msg.size());
+    xmd_sh256(b.data(), 256, msg.data(), msg.size(), reinterpret_cast<const uint8_t*>(CIPHERSUITE_ID.data()), CIPHERSUITE_ID.size());
+    if(a != b)
+    {
+        throw invalid_argument("expandMessageXmd must match xmd_sh256");
+    }
+    // batch expansion must match single expansions
+    const vector<vector<uint8_t>> msgs = {{}, {1, 2, 3}, msg, vector<uint8_t>(300, 0x62), {}, {4}, msg, {5, 6}, {7}};
+    vector<uint8_t> batch(msgs.size() * 256);
+    CIPHERSUITE_CONTEXT.expandMessageXmd(batch.data(), 256, msgs);
+    for(size_t i = 0; i < msgs.size(); i++)
+    {
+        CIPHERSUITE_CONTEXT.expandMessageXmd(a.data(), 256, msgs[i].data(), msgs[i].size());
+        if(!equal(a.begin(), a.end(), batch.begin() + i * 256))
+        {
+            throw invalid_argument("batch expandMessageXmd must match single expansion");
+        }
+    }
+    // DST lengths around the one and two block boundaries of the precomputed b_i tail
+    for(size_t dstLen : {22, 23, 86, 87, 255})
+    {
+        const hash_to_curve_context c(string(dstLen, 'D'));
+        c.expandMessageXmd(batch.data(), 256, span<const vector<uint8_t>>(&msg, 1));
+        c.expandMessageXmd(a.data(), 256, msg.data(), msg.size());
+        if(!equal(a.begin(), a.end(), batch.begin()))
+        {
+            throw invalid_argument("expandMessageXmd must match the batch expansion for every DST length");
+        }
+    }
+}
+
 /*
 void TestG1G2PackUnpack()
 {
@@ -952,6 +1211,38 @@ void TestG1G2PackUnpack()
 */
 ///////////////////////////////////////////////////////////
 
+void TestBatchAffine()
+{
+    vector<g1> p1 = {random_g1(), g1::zero(), random_g1().affine(), random_g1()};
+    vector<g1> q1 = p1;
+    g1::batchAffine(q1);
+    for(size_t i = 0; i < p1.size(); i++)
+    {
+        if(!q1[i].equal(p1[i]) || !(q1[i].isZero() || q1[i].isAffine()))
+        {
+            throw invalid_argument("g1 batch affine failed");
+        }
+        if(!q1[i].isZero() && !q1[i].x.equal(p1[i].affine().x))
+        {
+            throw invalid_argument("g1 batch affine must match affine");
+        }
+    }
+    vector<g2> p2 = {random_g2(), g2::zero(), random_g2().affine(), random_g2()};
+    vector<g2> q2 = p2;
+    g2::batchAffine(q2);
+    for(size_t i = 0; i < p2.size(); i++)
+    {
+        if(!q2[i].equal(p2[i]) || !(q2[i].isZero() || q2[i].isAffine()))
+        {
+            throw invalid_argument("g2 batch affine failed");
+        }
+        if(!q2[i].isZero() && !q2[i].y.equal(p2[i].affine().y))
+        {
+            throw invalid_argument("g2 batch affine must match affine");
+        }
+    }
+}
+
 void TestPairingExpected()
 {
     fp12 expected = fp12::fromBytesBE(hexToBytes<576>(
@@ -1178,6 +1469,108 @@ void TestPairingMulti()
     }
 }
 
+void TestPairingCheck()
+{
+    // e(a * G1, b * G2) * e(-(a * b) * G1, G2) == 1
+    array<uint64_t, 4> a = random_scalar();
+    array<uint64_t, 4> b = random_scalar();
+    array<uint64_t, 8> c = scalar::mul<8, 4, 4>(a, b);
+    g1 P1 = g1::one().mulScalar(a);
+    g2 P2 = g2::one().mulScalar(b);
+    g1 T1 = g1::one().mulScalar(c).neg();
+    vector<tuple<g1, g2>> v = {{P1, P2}, {T1, g2::one()}};
+    if(!pairing::check(v))
+    {
+        throw invalid_argument("check: product of pairings must be one");
+    }
+    // the same pairs, but with the G2 line coefficients precomputed
+    vector<tuple<g1, array<array<fp2, 3>, 68>>> vp(2);
+    g2 Q2 = P2.affine();
+    g2 G2 = g2::one();
+    get<g1>(vp[0]) = P1;
+    pairing::preCompute(get<1>(vp[0]), Q2);
+    get<g1>(vp[1]) = T1;
+    pairing::preCompute(get<1>(vp[1]), G2);
+    if(!pairing::check(vp))
+    {
+        throw invalid_argument("check (prepared): product of pairings must be one");
+    }
+    // the same pairs, but with the G2 line coefficients precomputed in compact form
+    vector<tuple<g1, array<array<fp2, 2>, 68>>> vc(2);
+    get<g1>(vc[0]) = P1;
+    pairing::preCompute(get<1>(vc[0]), Q2);
+    get<g1>(vc[1]) = T1;
+    pairing::preCompute(get<1>(vc[1]), G2);
+    if(!pairing::check(vc))
+    {
+        throw invalid_argument("check (compact): product of pairings must be one");
+    }
+    // compact and full line coefficients agree after the final exponentiation
+    {
+        g1 R1 = P1.affine();
+        array<array<fp2, 3>, 68> full;
+        array<array<fp2, 2>, 68> compact;
+        pairing::preCompute(full, Q2);
+        pairing::preCompute(compact, Q2);
+        const array<array<fp2, 3>, 68>* pf = &full;
+        const array<array<fp2, 2>, 68>* pc = &compact;
+        fp12 ef = pairing::millerLoop(span<const g1>(&R1, 1), span<const array<array<fp2, 3>, 68>* const>(&pf, 1));
+        fp12 ec = pairing::millerLoop(span<const g1>(&R1, 1), span<const array<array<fp2, 2>, 68>* const>(&pc, 1));
+        pairing::finalExp(ef);
+        pairing::finalExp(ec);
+        if(!ef.equal(ec))
+        {
+            throw invalid_argument("compact line coefficients give a different pairing");
+        }
+    }
+    // full and compact line coefficients mixed in one Miller loop
+    {
+        const g1 R[2] = {P1.affine(), T1.affine()};
+        const array<array<fp2, 3>, 68>* pf = &get<1>(vp[0]);
+        const array<array<fp2, 2>, 68>* pc = &get<1>(vc[1]);
+        fp12 f = pairing::millerLoop(
+            span<const g1>(&R[0], 1),
+            span<const array<array<fp2, 3>, 68>* const>(&pf, 1),
+            span<const g1>(&R[1], 1),
+            span<const array<array<fp2, 2>, 68>* const>(&pc, 1)
+        );
+        if(!pairing::finalExpIsOne(f))
+        {
+            throw invalid_argument("check (mixed): product of pairings must be one");
+        }
+    }
+    // a single non degenerate pairing is never one
+    v = {{P1, P2}};
+    if(pairing::check(v))
+    {
+        throw invalid_argument("check: pairing must not be one");
+    }
+    if(pairing::finalExpIsOne(pairing::millerLoop(v)) != pairing::calculate(v).isOne())
+    {
+        throw invalid_argument("check: finalExpIsOne must agree with finalExp");
+    }
+    // pairs containing the point at infinity are skipped
+    v = {{g1::zero(), P2}, {P1, g2::zero()}};
+    if(!pairing::check(v))
+    {
+        throw invalid_argument("check: pairings with infinity must be one");
+    }
+    vp.resize(1);
+    get<g1>(vp[0]) = P1;
+    get<1>(vp[0]) = {};
+    if(!pairing::check(vp))
+    {
+        throw invalid_argument("check (prepared): pairings with infinity must be one");
+    }
+    vc.resize(1);
+    get<g1>(vc[0]) = P1;
+    get<1>(vc[0]) = {};
+    if(!pairing::check(vc))
+    {
+        throw invalid_argument("check (compact): pairings with infinity must be one");
+    }
+}
+
 ///////////////////////////////////////////////////////////
 
 void TestEIP2333(string seedHex, string masterSkHex, string childSkHex, uint32_t childIndex)
@@ -1521,10 +1914,14 @@ void TestAugScheme()
     g1 pk2 = public_key(sk2);
 
     // Augmented Scheme: Each signer extends the same message with their individual public keys
-    vector<uint8_t> augMsg1 = message;
-    augMsg1.insert(augMsg1.end(), pk1.toAffineBytesBE().begin(), pk1.toAffineBytesBE().end());
-    vector<uint8_t> augMsg2 = message;
-    augMsg2.insert(augMsg2.end(), pk2.toAffineBytesBE().begin(), pk2.toAffineBytesBE().end());
+    array<uint8_t, 96> pk1Bytes = pk1.toAffineBytesBE();
+    array<uint8_t, 96> pk2Bytes = pk2.toAffineBytesBE();
+    vector<uint8_t> augMsg1(message.size() + pk1Bytes.size());
+    copy(message.begin(), message.end(), augMsg1.begin());
+    copy(pk1Bytes.begin(), pk1Bytes.end(), augMsg1.begin() + message.size());
+    vector<uint8_t> augMsg2(message.size() + pk2Bytes.size());
+    copy(message.begin(), message.end(), augMsg2.begin());
+    copy(pk2Bytes.begin(), pk2Bytes.end(), augMsg2.begin() + message.size());
     g2 sig1Aug = sign(sk1, augMsg1);
     g2 sig2Aug = sign(sk2, augMsg2);
     g2 aggSigAug = aggregate_signatures({sig1Aug, sig2Aug});
@@ -1593,6 +1990,698 @@ void TestAggregateSKs()
     if(!aggregate_verify({aggPubKey, pk2}, vector<vector<uint8_t>>{message, message2}, aggSigFinal, true)) throw invalid_argument("verify with aggPubKey failed");
 }
 
+void TestShardedAggregateVerify()
+{
+    const size_t numSigs = 12;
+    const size_t numWorkers = 3;
+    vector<g1> pks;
+    vector<vector<uint8_t>> msgs;
+    vector<g2> sigs;
+    for(size_t i = 0; i < numSigs; i++)
+    {
+        array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x10 + i));
+        vector<uint8_t> msg = {static_cast<uint8_t>(i), 42, 7};
+        pks.push_back(public_key(sk));
+        msgs.push_back(msg);
+        sigs.push_back(sign(sk, msg));
+    }
+    g2 aggSig = aggregate_signatures(sigs);
+
+    // every worker process computes the partial product of its shard and sends it back serialized
+    vector<fp12> partials;
+    for(size_t w = 0; w < numWorkers; w++)
+    {
+        int fd[2];
+        if(pipe(fd) != 0)
+        {
+            throw runtime_error("pipe failed");
+        }
+        pid_t pid = fork();
+        if(pid < 0)
+        {
+            throw runtime_error("fork failed");
+        }
+        if(pid == 0)
+        {
+            close(fd[0]);
+            vector<g1> shardPks;
+            vector<vector<uint8_t>> shardMsgs;
+            for(size_t i = w; i < numSigs; i += numWorkers)
+            {
+                shardPks.push_back(pks[i]);
+                shardMsgs.push_back(msgs[i]);
+            }
+            fp12 partial;
+            bool ok = aggregate_verify_partial(partial, shardPks, shardMsgs);
+            array<uint8_t, 576> bytes = partial.toBytesBE();
+            bool sent = ok && write(fd[1], bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+            close(fd[1]);
+            _exit(sent ? 0 : 1);
+        }
+        close(fd[1]);
+        array<uint8_t, 576> bytes;
+        size_t n = 0;
+        while(n < bytes.size())
+        {
+            ssize_t r = read(fd[0], bytes.data() + n, bytes.size() - n);
+            if(r <= 0)
+            {
+                break;
+            }
+            n += r;
+        }
+        close(fd[0]);
+        int status;
+        waitpid(pid, &status, 0);
+        if(n != bytes.size() || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            throw invalid_argument("worker failed");
+        }
+        partials.push_back(fp12::fromBytesBE(bytes));
+    }
+    if(!aggregate_verify_combine(partials, aggSig))
+    {
+        throw invalid_argument("sharded aggregate verify failed");
+    }
+    if(aggregate_verify_combine(partials, sigs[0]))
+    {
+        throw invalid_argument("sharded aggregate verify with wrong signature must fail");
+    }
+    partials.pop_back();
+    if(aggregate_verify_combine(partials, aggSig))
+    {
+        throw invalid_argument("sharded aggregate verify with missing shard must fail");
+    }
+    // combining the partials of a plain multi pairing gives the same result as calculate
+    vector<tuple<g1, g2>> v0 = {{pks[0], sigs[0]}, {pks[1], sigs[1]}};
+    vector<tuple<g1, g2>> v1 = {{pks[2], sigs[2]}};
+    vector<tuple<g1, g2>> v = {{pks[0], sigs[0]}, {pks[1], sigs[1]}, {pks[2], sigs[2]}};
+    vector<fp12> f = {pairing::millerLoop(v0), pairing::millerLoop(v1)};
+    if(!pairing::calculateCombined(f).equal(pairing::calculate(v)))
+    {
+        throw invalid_argument("combined partial products must match the multi pairing");
+    }
+}
+
+void TestGroupedAggregateVerify()
+{
+    // many signers on a few distinct messages
+    vector<g1> pks;
+    vector<vector<uint8_t>> msgs;
+    vector<g2> sigs;
+    for(size_t i = 0; i < 12; i++)
+    {
+        array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x50 + i));
+        vector<uint8_t> msg = {static_cast<uint8_t>(i % 3), 9, 9};
+        pks.push_back(public_key(sk));
+        msgs.push_back(msg);
+        sigs.push_back(sign(sk, msg));
+    }
+    g2 aggSig = aggregate_signatures(sigs);
+    if(!aggregate_verify(pks, msgs, aggSig))
+    {
+        throw invalid_argument("grouped aggregate verify failed");
+    }
+    if(aggregate_verify(pks, msgs, aggSig, true))
+    {
+        throw invalid_argument("aggregate verify must reject duplicate messages if requested");
+    }
+    swap(msgs[0], msgs[1]);
+    if(aggregate_verify(pks, msgs, aggSig))
+    {
+        throw invalid_argument("grouped aggregate verify with swapped messages must fail");
+    }
+    swap(msgs[0], msgs[1]);
+    fp12 partial;
+    vector<fp12> partials;
+    if(!aggregate_verify_partial(partial, pks, msgs))
+    {
+        throw invalid_argument("grouped aggregate verify partial failed");
+    }
+    partials.push_back(partial);
+    if(!aggregate_verify_combine(partials, aggSig))
+    {
+        throw invalid_argument("grouped aggregate verify combine failed");
+    }
+}
+
+void TestPreparedPublicKey()
+{
+    array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x21));
+    const vector<uint8_t> msg = {1, 2, 3};
+    const g1 pk = public_key(sk);
+    const g2 sig = sign(sk, msg);
+
+    // jacobian input is stored affine
+    const public_key_prepared prepared(pk.dbl());
+    if(!prepared.point().isAffine() || !prepared.point().equal(pk.dbl()))
+    {
+        throw invalid_argument("prepared public key must be stored affine");
+    }
+    const public_key_prepared decoded = public_key_prepared::fromCompressedBytesBE(pk.toCompressedBytesBE());
+    if(decoded.compressed() != pk.toCompressedBytesBE() || !decoded.point().equal(pk))
+    {
+        throw invalid_argument("prepared public key from compressed bytes mismatch");
+    }
+    if(!verify(decoded, msg, sig) || verify(prepared, msg, sig))
+    {
+        throw invalid_argument("verify with prepared public key failed");
+    }
+    if(!aggregate_verify(vector<public_key_prepared>{decoded}, {msg}, sig))
+    {
+        throw invalid_argument("aggregate verify with prepared public keys failed");
+    }
+
+    bool thrown = false;
+    try
+    {
+        public_key_prepared invalid(g1({fp::one(), fp::one(), fp::one()}));
+    }
+    catch(const invalid_argument&)
+    {
+        thrown = true;
+    }
+    if(!thrown)
+    {
+        throw invalid_argument("prepared public key must reject points not on the curve");
+    }
+}
+
+void TestPointCache()
+{
+    g1_cache c1(4, 2);
+    vector<array<uint8_t, 48>> keys;
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        keys.push_back(public_key(secret_key(vector<uint8_t>(32, 0x30 + i))).toCompressedBytesBE());
+    }
+    for(const auto& k : keys)
+    {
+        if(!g1::fromCompressedBytesBE(k, c1).equal(g1::fromCompressedBytesBE(k)))
+        {
+            throw invalid_argument("cached g1 decompression mismatch");
+        }
+    }
+    if(c1.misses() != 8 || c1.hits() != 0 || c1.size() > c1.capacity())
+    {
+        throw invalid_argument("g1 cache must stay within its capacity");
+    }
+    g1::fromCompressedBytesBE(keys.back(), c1);
+    if(c1.hits() != 1)
+    {
+        throw invalid_argument("g1 cache must hit on a repeated key");
+    }
+
+    // concurrent lookups of the same signatures
+    g2_cache c2(16);
+    array<uint8_t, 96> sig = sign(secret_key(vector<uint8_t>(32, 0x40)), {1, 2}).toCompressedBytesBE();
+    vector<thread> workers;
+    for(size_t t = 0; t < 4; t++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(size_t i = 0; i < 10; i++)
+            {
+                g2::fromCompressedBytesBE(sig, c2);
+            }
+        });
+    }
+    for(thread& w : workers)
+    {
+        w.join();
+    }
+    if(c2.hits() + c2.misses() != 40 || c2.size() != 1)
+    {
+        throw invalid_argument("g2 cache counters wrong after concurrent lookups");
+    }
+
+    // points outside of the subgroup are rejected and not cached
+    fp xNum, xDen, y;
+    tie(xNum, xDen, y) = g1::swuMapG1(fp::one());
+    array<uint8_t, 48> bad = g1::isogenyMapG1(xNum, xDen, y).toCompressedBytesBE();
+    bool thrown = false;
+    try
+    {
+        g1::fromCompressedBytesBE(bad, c1);
+    }
+    catch(const invalid_argument&)
+    {
+        thrown = true;
+    }
+    if(!thrown || c1.find(bad))
+    {
+        throw invalid_argument("g1 cache must reject points outside of the subgroup");
+    }
+}
+
+void TestMessageCache()
+{
+    array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x61));
+    const g1 pk = public_key(sk);
+    const vector<uint8_t> msg = {0xbe, 0xef};
+    const g2 expected = sign(sk, msg);
+    array<uint64_t, 4> sk2 = secret_key(vector<uint8_t>(32, 0x62));
+    const g1 pk2 = public_key(sk2);
+    const g2 expected2 = sign(sk2, {0x42});
+
+    for(const bool prepared : {false, true})
+    {
+        configure_message_cache(8, prepared);
+        hashed_message_cache().clear();
+        const g2 sig = sign(sk, msg);
+        if(!sig.equal(expected) || !verify(pk, msg, sig) || verify(pk, {0xbe}, sig))
+        {
+            throw invalid_argument("message cache: sign/verify mismatch");
+        }
+        if(!pop_fast_aggregate_verify({pk}, msg, sig) || !aggregate_verify({pk}, {msg}, sig))
+        {
+            throw invalid_argument("message cache: aggregate verify failed");
+        }
+        // the first sign misses; verify, pop_fast_aggregate_verify and aggregate_verify hit
+        if(hashed_message_cache().hits() != 3 || hashed_message_cache().misses() != 2)
+        {
+            throw invalid_argument("message cache: unexpected hit/miss counts");
+        }
+        // a cached and a new message in one aggregate, with the cached lines joining the computed ones
+        const vector<uint8_t> msg2 = {0x42};
+        const g2 agg = aggregate_signatures({sig, expected2});
+        if(!aggregate_verify({pk, pk2}, {msg, msg2}, agg) || aggregate_verify({pk2, pk}, {msg, msg2}, agg))
+        {
+            throw invalid_argument("message cache: aggregate of cached and new messages");
+        }
+    }
+    configure_message_cache(0);
+    if(hashed_message_cache().size() != 0 || !verify(pk, msg, expected))
+    {
+        throw invalid_argument("message cache: disabling must empty the cache");
+    }
+}
+
+void TestVerificationCache()
+{
+    array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x71));
+    const g1 pk = public_key(sk);
+    const vector<uint8_t> msg = {7, 7, 7};
+    const g2 sig = sign(sk, msg);
+    const g2 pop = pop_prove(sk);
+
+    verification_cache cache(16, chrono::hours(1));
+    if(!verify(pk, msg, sig, cache) || !verify(pk, msg, sig, cache) || !pop_verify(pk, pop, cache))
+    {
+        throw invalid_argument("verification cache: valid triples must verify");
+    }
+    if(cache.hits() != 1 || cache.misses() != 2 || cache.size() != 2)
+    {
+        throw invalid_argument("verification cache: unexpected counters");
+    }
+    // negative results are not recorded, the cached result does not cover other messages or proofs
+    if(verify(pk, {7, 7}, sig, cache) || verify(pk, {7, 7}, sig, cache) || pop_verify(pk, sig, cache))
+    {
+        throw invalid_argument("verification cache: invalid triples must fail");
+    }
+    if(cache.size() != 2)
+    {
+        throw invalid_argument("verification cache: only positive results may be cached");
+    }
+
+    verification_cache expired(16, chrono::seconds(0));
+    verify(pk, msg, sig, expired);
+    if(!verify(pk, msg, sig, expired) || expired.hits() != 0)
+    {
+        throw invalid_argument("verification cache: expired entries must not hit");
+    }
+}
+
+void TestCommittee()
+{
+    const vector<uint8_t> msg = {1, 1, 2, 3, 5};
+    vector<array<uint64_t, 4>> sks;
+    vector<g1> pks;
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        sks.push_back(secret_key(vector<uint8_t>(32, 0x80 + i)));
+        pks.push_back(public_key(sks.back()));
+    }
+    committee c(pks);
+
+    // few absent (subtracted from the total) and few present (summed up) members
+    for(const vector<bool>& participation : {vector<bool>{1, 1, 0, 1, 1, 1, 1, 1}, vector<bool>{0, 1, 0, 0, 0, 1, 0, 0}})
+    {
+        vector<g1> present;
+        vector<g2> sigs;
+        for(size_t i = 0; i < pks.size(); i++)
+        {
+            if(participation[i])
+            {
+                present.push_back(pks[i]);
+                sigs.push_back(sign(sks[i], msg));
+            }
+        }
+        if(!c.aggregate(participation).equal(aggregate_public_keys(present)))
+        {
+            throw invalid_argument("committee: aggregate of participation subset mismatch");
+        }
+        if(!pop_fast_aggregate_verify(c, participation, msg, aggregate_signatures(sigs)))
+        {
+            throw invalid_argument("committee: pop_fast_aggregate_verify failed");
+        }
+    }
+
+    sks[3] = secret_key(vector<uint8_t>(32, 0x99));
+    pks[3] = public_key(sks[3]);
+    c.update(3, pks[3]);
+    if(!c.aggregate().equal(aggregate_public_keys(pks)) || !c.member(3).equal(pks[3]))
+    {
+        throw invalid_argument("committee: update must replace the member and its share of the total");
+    }
+    if(pop_fast_aggregate_verify(c, vector<bool>(8, false), msg, sign(sks[0], msg)))
+    {
+        throw invalid_argument("committee: empty participation must fail");
+    }
+}
+
+void TestParallelAggregation()
+{
+    // enough points for several chunks, mixed affine and jacobian
+    vector<g1> pks;
+    vector<array<uint8_t, 48>> bytes;
+    g1 p = g1::one();
+    g1 expected = g1::zero();
+    for(size_t i = 0; i < 2500; i++)
+    {
+        p = p.add(g1::one());
+        pks.push_back(i % 3 == 0 ? p : p.affine());
+        bytes.push_back(p.toCompressedBytesBE());
+        expected = expected.add(p);
+    }
+    if(!aggregate_public_keys(pks).equal(expected) || !aggregate_public_keys(span<const array<uint8_t, 48>>(bytes)).equal(expected))
+    {
+        throw invalid_argument("parallel public key aggregation mismatch");
+    }
+
+    vector<g2> sigs = {random_g2(), random_g2(), random_g2().affine()};
+    vector<array<uint8_t, 96>> sigBytes;
+    for(const g2& sig : sigs)
+    {
+        sigBytes.push_back(sig.toCompressedBytesBE());
+    }
+    const g2 agg = sigs[0].add(sigs[1]).add(sigs[2]);
+    if(!aggregate_signatures(sigs).equal(agg) || !aggregate_signatures(span<const array<uint8_t, 96>>(sigBytes)).equal(agg))
+    {
+        throw invalid_argument("parallel signature aggregation mismatch");
+    }
+
+    bytes[1234][0] &= 0x7f;
+    bool thrown = false;
+    try
+    {
+        aggregate_public_keys(span<const array<uint8_t, 48>>(bytes));
+    }
+    catch(const invalid_argument&)
+    {
+        thrown = true;
+    }
+    if(!thrown)
+    {
+        throw invalid_argument("aggregation of an invalid encoding must throw");
+    }
+}
+
+void TestAggregator()
+{
+    vector<g2> sigs;
+    g2 expected = g2::zero();
+    for(size_t i = 0; i < 8; i++)
+    {
+        sigs.push_back(i % 2 == 0 ? random_g2() : random_g2().affine());
+        expected = expected.add(sigs.back());
+    }
+
+    // concurrent ingestion, every signature from two threads but counted once per signer
+    aggregator<g2> agg(4);
+    vector<thread> threads;
+    for(size_t t = 0; t < 2; t++)
+    {
+        threads.emplace_back([&]() {
+            for(size_t i = 0; i < sigs.size(); i++)
+            {
+                agg.add(i, sigs[i]);
+            }
+        });
+    }
+    for(thread& t : threads)
+    {
+        t.join();
+    }
+    if(agg.count() != sigs.size() || !agg.aggregate().equal(expected) || agg.toCompressedBytesBE() != expected.toCompressedBytesBE())
+    {
+        throw invalid_argument("aggregator mismatch");
+    }
+    if(agg.add(3, sigs[3]) || !agg.affine().isAffine())
+    {
+        throw invalid_argument("aggregator must ignore duplicate signers");
+    }
+
+    aggregator<g1> pks(3), more;
+    pks.add(0, g1::one());
+    more.add(g1::one());
+    more.add(1, g1::one().dbl());
+    pks.merge(more);
+    if(pks.count() != 3 || !pks.aggregate().equal(g1::one().dbl().dbl()))
+    {
+        throw invalid_argument("aggregator merge mismatch");
+    }
+    bool thrown = false;
+    try
+    {
+        pks.merge(more);
+    }
+    catch(const invalid_argument&)
+    {
+        thrown = true;
+    }
+    if(!thrown || pks.count() != 3)
+    {
+        throw invalid_argument("merging aggregators with common signers must throw");
+    }
+    aggregator<g1> unsignedOnly;
+    unsignedOnly.add(g1::one());
+    thrown = false;
+    try
+    {
+        unsignedOnly.merge(unsignedOnly);
+    }
+    catch(const invalid_argument&)
+    {
+        thrown = true;
+    }
+    if(!thrown || unsignedOnly.count() != 1)
+    {
+        throw invalid_argument("merging an aggregator into itself must throw");
+    }
+    pks.clear();
+    if(pks.count() != 0 || !pks.aggregate().isZero())
+    {
+        throw invalid_argument("aggregator clear failed");
+    }
+}
+
+void TestAffinePoints()
+{
+    if(sizeof(g1_affine) >= sizeof(g1) || sizeof(g2_affine) >= sizeof(g2))
+    {
+        throw invalid_argument("affine types must be smaller than jacobian ones");
+    }
+
+    vector<g1> p1 = {random_g1(), g1::zero(), random_g1().affine(), random_g1()};
+    vector<g2> p2 = {random_g2(), g2::zero(), random_g2().affine(), random_g2()};
+    vector<g1_affine> a1 = g1_affine::fromJacobian(p1);
+    vector<g2_affine> a2 = g2_affine::fromJacobian(p2);
+    for(size_t i = 0; i < p1.size(); i++)
+    {
+        if(!g1(a1[i]).equal(p1[i]) || !a1[i].equal(g1_affine(p1[i])) || a1[i].isZero() != p1[i].isZero() || !a1[i].isOnCurve())
+        {
+            throw invalid_argument("g1_affine conversion mismatch");
+        }
+        if(!g2(a2[i]).equal(p2[i]) || !a2[i].equal(g2_affine(p2[i])) || a2[i].isZero() != p2[i].isZero() || !a2[i].isOnCurve())
+        {
+            throw invalid_argument("g2_affine conversion mismatch");
+        }
+        if(!g1_affine::fromCompressedBytesBE(a1[i].toCompressedBytesBE()).equal(a1[i])
+        || !g2_affine::fromCompressedBytesBE(a2[i].toCompressedBytesBE()).equal(a2[i]))
+        {
+            throw invalid_argument("affine compressed round trip failed");
+        }
+        if(!p1[0].addMixed(a1[i]).equal(p1[0].add(p1[i])) || !g1(a1[i].neg()).equal(p1[i].neg()))
+        {
+            throw invalid_argument("g1 + g1_affine mismatch");
+        }
+        if(!p2[0].addMixed(a2[i]).equal(p2[0].add(p2[i])) || !g2(a2[i].neg()).equal(p2[i].neg()))
+        {
+            throw invalid_argument("g2 + g2_affine mismatch");
+        }
+    }
+
+    if(!aggregate_public_keys(span<const g1_affine>(a1)).equal(aggregate_public_keys(p1))
+    || !aggregate_signatures(span<const g2_affine>(a2)).equal(aggregate_signatures(p2)))
+    {
+        throw invalid_argument("affine aggregation mismatch");
+    }
+
+    vector<array<uint64_t, 4>> s = {random_scalar(), random_scalar(), random_scalar(), random_scalar()};
+    vector<array<uint64_t, 4>> t = s, u = s;
+    if(!g1::multiExp(span<const g1_affine>(a1), t).equal(g1::multiExp(p1, u)))
+    {
+        throw invalid_argument("affine g1 multiExp mismatch");
+    }
+    t = s;
+    u = s;
+    if(!g2::multiExp(span<const g2_affine>(a2), t).equal(g2::multiExp(p2, u)))
+    {
+        throw invalid_argument("affine g2 multiExp mismatch");
+    }
+
+    // e(a, b) * e(-a, b) * e(0, b) == 1
+    const vector<tuple<g1_affine, g2_affine>> pairs = {{a1[0], a2[0]}, {a1[0].neg(), a2[0]}, {a1[1], a2[0]}};
+    const vector<tuple<g1_affine, g2_affine>> bad = {{a1[0], a2[0]}, {a1[2].neg(), a2[0]}};
+    if(!pairing::check(pairs) || pairing::check(bad))
+    {
+        throw invalid_argument("affine pairing check mismatch");
+    }
+}
+
+void TestProjectivePoints()
+{
+    const g1 a1 = random_g1(), b1 = random_g1();
+    const g2 a2 = random_g2(), b2 = random_g2();
+    const g1_projective p1(a1), q1(b1), z1 = g1_projective::zero();
+    const g2_projective p2(a2), q2(b2), z2 = g2_projective::zero();
+
+    // generic, doubling and infinity cases all go through the same formulas
+    if(!g1(p1.add(q1)).equal(a1.add(b1)) || !g1(p1.add(p1)).equal(a1.dbl()) || !g1(p1.dbl()).equal(a1.dbl())
+    || !p1.add(p1.neg()).isZero() || !p1.add(z1).equal(p1) || !z1.add(p1).equal(p1) || !z1.dbl().isZero())
+    {
+        throw invalid_argument("g1_projective add/dbl mismatch");
+    }
+    if(!g2(p2.add(q2)).equal(a2.add(b2)) || !g2(p2.add(p2)).equal(a2.dbl()) || !g2(p2.dbl()).equal(a2.dbl())
+    || !p2.add(p2.neg()).isZero() || !p2.add(z2).equal(p2) || !z2.add(p2).equal(p2) || !z2.dbl().isZero())
+    {
+        throw invalid_argument("g2_projective add/dbl mismatch");
+    }
+    if(!g1(p1.addMixed(g1_affine(b1))).equal(a1.add(b1)) || !p1.addMixed(g1_affine(a1)).equal(p1.dbl())
+    || !p1.addMixed(g1_affine::zero()).equal(p1) || !g1(z1.addMixed(g1_affine(b1))).equal(b1))
+    {
+        throw invalid_argument("g1_projective addMixed mismatch");
+    }
+    if(!g2(p2.addMixed(g2_affine(b2))).equal(a2.add(b2)) || !p2.addMixed(g2_affine(a2)).equal(p2.dbl())
+    || !p2.addMixed(g2_affine::zero()).equal(p2) || !g2(z2.addMixed(g2_affine(b2))).equal(b2))
+    {
+        throw invalid_argument("g2_projective addMixed mismatch");
+    }
+
+    const array<uint64_t, 4> k = random_scalar(), none = {0, 0, 0, 0};
+    if(!g1(p1.mulScalar(k)).equal(a1.mulScalar(k)) || !p1.mulScalar(none).isZero()
+    || !g2(p2.mulScalar(k)).equal(a2.mulScalar(k)) || !p2.mulScalar(none).isZero())
+    {
+        throw invalid_argument("projective mulScalar mismatch");
+    }
+
+    // secret key operations normalize in constant time and match the variable time path
+    const array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x42));
+    const vector<uint8_t> msg = {1, 2, 3};
+    const g1 pk = public_key(sk);
+    const g2 sig = sign(sk, msg);
+    if(!pk.isAffine() || !pk.equal(g1::one().mulScalar(sk)) || !p1.affine().equal(a1) || !z1.affine().isZero())
+    {
+        throw invalid_argument("public_key must equal the mulScalar path");
+    }
+    if(!sig.isAffine() || !sig.equal(g2::fromMessage(msg, CIPHERSUITE_ID).mulScalar(sk)) || !p2.affine().equal(a2) || !z2.affine().isZero())
+    {
+        throw invalid_argument("sign must equal the mulScalar path");
+    }
+    const fp e = random_g1().x;
+    const fp2 f = random_g2().x;
+    if(!e.inverseConstTime().equal(e.inverse()) || !f.inverseConstTime().equal(f.inverse()) || !fp::zero().inverseConstTime().isZero())
+    {
+        throw invalid_argument("constant time inversion mismatch");
+    }
+}
+
+void TestBatchVerify()
+{
+    const size_t numSigs = 8;
+    vector<g1> pks;
+    vector<vector<uint8_t>> msgs;
+    vector<g2> sigs;
+    for(size_t i = 0; i < numSigs; i++)
+    {
+        array<uint64_t, 4> sk = secret_key(vector<uint8_t>(32, 0x30 + i));
+        vector<uint8_t> msg = {static_cast<uint8_t>(i), 1, 2, 3};
+        pks.push_back(public_key(sk));
+        msgs.push_back(msg);
+        sigs.push_back(sign(sk, msg));
+    }
+    if(!batch_verify(pks, msgs, sigs))
+    {
+        throw invalid_argument("batch verify failed");
+    }
+    // the same message signed by different keys
+    msgs[1] = msgs[0];
+    sigs[1] = sign(secret_key(vector<uint8_t>(32, 0x31)), msgs[1]);
+    if(!batch_verify(pks, msgs, sigs))
+    {
+        throw invalid_argument("batch verify with repeated message failed");
+    }
+    // swapping two signatures leaves their sum unchanged but must be detected
+    vector<g2> swapped = sigs;
+    swap(swapped[2], swapped[3]);
+    if(batch_verify(pks, msgs, swapped))
+    {
+        throw invalid_argument("batch verify with swapped signatures must fail");
+    }
+    vector<vector<uint8_t>> wrongMsgs = msgs;
+    wrongMsgs[5][0] ^= 1;
+    if(batch_verify(pks, wrongMsgs, sigs))
+    {
+        throw invalid_argument("batch verify with wrong message must fail");
+    }
+    // localization of the invalid entries
+    vector<size_t> invalid = {42};
+    if(!batch_verify(pks, msgs, sigs, &invalid) || !invalid.empty())
+    {
+        throw invalid_argument("batch verify with localization failed");
+    }
+    if(batch_verify(pks, wrongMsgs, swapped, &invalid) || invalid != vector<size_t>{2, 3, 5})
+    {
+        throw invalid_argument("batch verify must localize the invalid entries");
+    }
+    swapped[7] = g2({fp2::one(), fp2::one(), fp2::one()});
+    if(batch_verify(pks, msgs, swapped, &invalid) || invalid != vector<size_t>{2, 3, 7})
+    {
+        throw invalid_argument("batch verify must localize invalid points");
+    }
+    // the cached compact lines of a message shared by a valid and an invalid entry
+    configure_message_cache(16, true);
+    vector<g2> shared = sigs;
+    shared[1] = sigs[0];
+    if(batch_verify(pks, msgs, shared, &invalid) || invalid != vector<size_t>{1})
+    {
+        throw invalid_argument("batch verify must localize the invalid entries with prepared messages");
+    }
+    configure_message_cache(0);
+    if(batch_verify(pks, msgs, vector<g2>(sigs.begin(), sigs.end() - 1)) || batch_verify({}, {}, {}))
+    {
+        throw invalid_argument("batch verify with bad sizes must fail");
+    }
+    // short scalar multi exponentiation
+    vector<array<uint64_t, 4>> s = {{0xffffffffffffffff, 0, 0, 0}, {0x123456789abcdef, 0, 0, 0}};
+    g2 e = sigs[0].mulScalar(array<uint64_t, 1>{s[0][0]}).add(sigs[1].mulScalar(array<uint64_t, 1>{s[1][0]}));
+    if(!g2::multiExp({sigs[0], sigs[1]}, s, 64).equal(e))
+    {
+        throw invalid_argument("short scalar multiExp failed");
+    }
+}
+
 void TestPopScheme()
 {
     {
@@ -1677,12 +2766,14 @@ void TestPopScheme()
 int main()
 {
     TestScalar();
+    TestWideReduction();
 
     TestFieldElementValidation();
     TestFieldElementEquality();
     TestFieldElementHelpers();
     TestFieldElementSerialization();
     TestFieldElementByteInputs();
+    TestFieldElementSparseMul();
 
     TestG1Serialization();
     TestG1IsOnCurve();
@@ -1700,11 +2791,17 @@ int main()
     TestG2MultiExpExpected();
     TestG2MultiExpBatch();
     TestG2MapToCurve();
+    TestG2FromMessages();
+    TestSha256Transforms();
+    TestSha256DigestMany();
+    TestExpandMessageXmd();
 
+    TestBatchAffine();
     TestPairingExpected();
     TestPairingNonDegeneracy();
     TestPairingBilinearity();
     TestPairingMulti();
+    TestPairingCheck();
 
     TestsEIP2333();
     TestUnhardenedHDKeys();
@@ -1716,6 +2813,18 @@ int main()
     TestAugScheme();
     TestAggregateSKs();
     TestPopScheme();
+    TestShardedAggregateVerify();
+    TestGroupedAggregateVerify();
+    TestPreparedPublicKey();
+    TestPointCache();
+    TestMessageCache();
+    TestVerificationCache();
+    TestCommittee();
+    TestParallelAggregation();
+    TestAggregator();
+    TestAffinePoints();
+    TestProjectivePoints();
+    TestBatchVerify();
     
     return 0;
 }